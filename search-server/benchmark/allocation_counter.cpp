@@ -0,0 +1,40 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocation_counter.h"
+
+using namespace std;
+
+namespace {
+
+atomic<uint64_t> allocation_count{ 0 };
+atomic<uint64_t> allocated_bytes{ 0 };
+
+}
+
+uint64_t GetAllocationCount() {
+    return allocation_count.load(memory_order_relaxed);
+}
+
+uint64_t GetAllocatedBytes() {
+    return allocated_bytes.load(memory_order_relaxed);
+}
+
+// The array and nothrow forms call these ones by default.
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    allocated_bytes.fetch_add(size, memory_order_relaxed);
+    if (void* memory = malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
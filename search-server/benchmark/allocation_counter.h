@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+// The benchmark replaces the global operator new and delete to count heap
+// allocations of every thread. Aligned allocations are not counted.
+uint64_t GetAllocationCount();
+uint64_t GetAllocatedBytes();
@@ -0,0 +1,347 @@
+// Benchmarks of the search server on a synthetic Zipfian corpus. Build from the
+// search-server directory with
+//     g++ -std=c++17 -O2 $(ls *.cpp | grep -v -e main.cpp -e test_example_functions.cpp) benchmark/*.cpp -ltbb -lpthread -o search_server_benchmark
+// and run with options --name=value, for example
+//     ./search_server_benchmark --documents=20000 --zipf=1.1 --output=report.json
+// The corpus depends on the options alone, so two builds given the same options
+// run the same workload, and their JSON reports can be diffed.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../concurrent_request_queue.h"
+#include "../document.h"
+#include "../paginator.h"
+#include "../relevance_accumulator.h"
+#include "../request_queue.h"
+#include "../search_server.h"
+#include "allocation_counter.h"
+#include "benchmark_report.h"
+#include "corpus_generator.h"
+
+using namespace std;
+
+namespace {
+
+struct BenchmarkOptions {
+    CorpusConfig corpus;
+    size_t max_top_k_size = 10000000;
+    string output_path;
+};
+
+BenchmarkOptions ParseOptions(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    CorpusConfig& corpus = options.corpus;
+    for (int i = 1; i < argc; ++i) {
+        const string_view argument = argv[i];
+        const size_t equals_position = argument.find('=');
+        if (argument.substr(0, 2) != "--"sv || equals_position == string_view::npos) {
+            throw invalid_argument("expected --name=value, got "s + string(argument));
+        }
+        const string_view name = argument.substr(2, equals_position - 2);
+        const string value(argument.substr(equals_position + 1));
+        if (name == "seed"sv) {
+            corpus.seed = stoull(value);
+        }
+        else if (name == "documents"sv) {
+            corpus.document_count = stoul(value);
+        }
+        else if (name == "vocabulary"sv) {
+            corpus.vocabulary_size = stoul(value);
+        }
+        else if (name == "zipf"sv) {
+            corpus.zipf_exponent = stod(value);
+        }
+        else if (name == "min-length"sv) {
+            corpus.min_document_length = stoul(value);
+        }
+        else if (name == "max-length"sv) {
+            corpus.max_document_length = stoul(value);
+        }
+        else if (name == "stop-words"sv) {
+            corpus.stop_word_count = stoul(value);
+        }
+        else if (name == "stop-word-ratio"sv) {
+            corpus.stop_word_ratio = stod(value);
+        }
+        else if (name == "queries"sv) {
+            corpus.query_count = stoul(value);
+        }
+        else if (name == "max-query-length"sv) {
+            corpus.max_query_length = stoul(value);
+        }
+        else if (name == "minus-word-ratio"sv) {
+            corpus.minus_word_ratio = stod(value);
+        }
+        else if (name == "max-top-k-size"sv) {
+            options.max_top_k_size = stoul(value);
+        }
+        else if (name == "output"sv) {
+            options.output_path = value;
+        }
+        else {
+            throw invalid_argument("unknown option "s + string(name));
+        }
+    }
+    if (corpus.vocabulary_size == 0 || corpus.min_document_length == 0 || corpus.min_document_length > corpus.max_document_length
+        || corpus.min_query_length == 0 || corpus.min_query_length > corpus.max_query_length) {
+        throw invalid_argument("empty vocabulary or invalid document or query lengths"s);
+    }
+    return options;
+}
+
+void AddConfig(BenchmarkReport& report, const BenchmarkOptions& options) {
+    const CorpusConfig& corpus = options.corpus;
+    report.AddConfig("seed", static_cast<double>(corpus.seed));
+    report.AddConfig("documents", static_cast<double>(corpus.document_count));
+    report.AddConfig("vocabulary", static_cast<double>(corpus.vocabulary_size));
+    report.AddConfig("zipf", corpus.zipf_exponent);
+    report.AddConfig("min_length", static_cast<double>(corpus.min_document_length));
+    report.AddConfig("max_length", static_cast<double>(corpus.max_document_length));
+    report.AddConfig("stop_words", static_cast<double>(corpus.stop_word_count));
+    report.AddConfig("stop_word_ratio", corpus.stop_word_ratio);
+    report.AddConfig("queries", static_cast<double>(corpus.query_count));
+    report.AddConfig("max_query_length", static_cast<double>(corpus.max_query_length));
+    report.AddConfig("minus_word_ratio", corpus.minus_word_ratio);
+    report.AddConfig("max_top_k_size", static_cast<double>(options.max_top_k_size));
+}
+
+using Clock = chrono::steady_clock;
+
+uint64_t GetNanoseconds(Clock::time_point start, Clock::time_point finish) {
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(finish - start).count());
+}
+
+double GetSeconds(Clock::time_point start, Clock::time_point finish) {
+    return chrono::duration<double>(finish - start).count();
+}
+
+// Hashes the result ids in their order, so a report shows when a change alters what
+// is found rather than how fast. The sequential and parallel searches return the same
+// documents in the same order, so their checksums must be equal.
+uint64_t UpdateChecksum(uint64_t checksum, const vector<Document>& documents) {
+    for (const Document& document : documents) {
+        checksum = checksum * 1099511628211ull + static_cast<uint64_t>(document.id) + 1;
+    }
+    return checksum * 1099511628211ull + documents.size();
+}
+
+void BenchmarkAddDocument(BenchmarkReport& report, const Corpus& corpus, SearchServer& search_server) {
+    const uint64_t allocations_before = GetAllocationCount();
+    const uint64_t bytes_before = GetAllocatedBytes();
+    const auto start = Clock::now();
+    for (size_t i = 0; i < corpus.documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), corpus.documents[i], corpus.statuses[i], corpus.ratings[i]);
+    }
+    const auto finish = Clock::now();
+    const double document_count = static_cast<double>(max<size_t>(corpus.documents.size(), 1));
+    report.AddMetric("add_document", "seconds", GetSeconds(start, finish));
+    report.AddMetric("add_document", "documents_per_second", round(document_count / GetSeconds(start, finish)));
+    report.AddMetric("add_document", "allocations_per_document", static_cast<double>(GetAllocationCount() - allocations_before) / document_count);
+    report.AddMetric("add_document", "bytes_per_document", round(static_cast<double>(GetAllocatedBytes() - bytes_before) / document_count));
+}
+
+void BenchmarkAddDocuments(BenchmarkReport& report, const Corpus& corpus) {
+    vector<NewDocument> documents(corpus.documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        documents[i] = { static_cast<int>(i), corpus.documents[i], corpus.statuses[i], corpus.ratings[i] };
+    }
+    SearchServer search_server(corpus.stop_words);
+    const uint64_t allocations_before = GetAllocationCount();
+    const auto start = Clock::now();
+    const vector<RejectedDocument> rejected_documents = search_server.AddDocuments(documents);
+    const auto finish = Clock::now();
+    const double document_count = static_cast<double>(max<size_t>(documents.size(), 1));
+    report.AddMetric("add_documents", "seconds", GetSeconds(start, finish));
+    report.AddMetric("add_documents", "documents_per_second", round(document_count / GetSeconds(start, finish)));
+    report.AddMetric("add_documents", "allocations_per_document", static_cast<double>(GetAllocationCount() - allocations_before) / document_count);
+    report.AddMetric("add_documents", "rejected_documents", static_cast<double>(rejected_documents.size()));
+}
+
+template <typename FindTopDocuments>
+void BenchmarkQueries(BenchmarkReport& report, const string& benchmark, const Corpus& corpus, FindTopDocuments find_top_documents) {
+    vector<uint64_t> latencies;
+    latencies.reserve(corpus.queries.size());
+    uint64_t checksum = 0;
+    size_t result_document_count = 0;
+    const uint64_t allocations_before = GetAllocationCount();
+    const uint64_t dense_accumulators_before = RelevanceAccumulator::GetDenseAccumulatorCount();
+    for (const string& query : corpus.queries) {
+        const auto start = Clock::now();
+        const vector<Document> documents = find_top_documents(query);
+        latencies.push_back(GetNanoseconds(start, Clock::now()));
+        checksum = UpdateChecksum(checksum, documents);
+        result_document_count += documents.size();
+    }
+    const double query_count = static_cast<double>(max<size_t>(corpus.queries.size(), 1));
+    report.AddLatencies(benchmark, move(latencies));
+    report.AddMetric(benchmark, "allocations_per_query", static_cast<double>(GetAllocationCount() - allocations_before) / query_count);
+    report.AddMetric(benchmark, "dense_accumulators_per_query",
+        static_cast<double>(RelevanceAccumulator::GetDenseAccumulatorCount() - dense_accumulators_before) / query_count);
+    report.AddMetric(benchmark, "result_documents", static_cast<double>(result_document_count));
+    report.AddMetric(benchmark, "result_checksum", static_cast<double>(checksum % (uint64_t{ 1 } << 53)));
+}
+
+void BenchmarkMatchDocument(BenchmarkReport& report, const Corpus& corpus, const SearchServer& search_server) {
+    if (corpus.documents.empty()) {
+        return;
+    }
+    vector<uint64_t> latencies;
+    latencies.reserve(corpus.queries.size());
+    BenchmarkRandom random(corpus.queries.size());
+    size_t matched_word_count = 0;
+    const uint64_t allocations_before = GetAllocationCount();
+    for (const string& query : corpus.queries) {
+        const int document_id = static_cast<int>(random.NextIndex(corpus.documents.size()));
+        const auto start = Clock::now();
+        const auto [matched_words, status] = search_server.MatchDocument(query, document_id);
+        latencies.push_back(GetNanoseconds(start, Clock::now()));
+        matched_word_count += matched_words.size();
+    }
+    const double query_count = static_cast<double>(max<size_t>(corpus.queries.size(), 1));
+    report.AddLatencies("match_document", move(latencies));
+    report.AddMetric("match_document", "allocations_per_query", static_cast<double>(GetAllocationCount() - allocations_before) / query_count);
+    report.AddMetric("match_document", "matched_words", static_cast<double>(matched_word_count));
+}
+
+void BenchmarkPaginate(BenchmarkReport& report, const SearchServer& search_server) {
+    const vector<int> document_ids(search_server.begin(), search_server.end());
+    for (const size_t page_size : { 1, 10, 100 }) {
+        const string benchmark = "paginate_"s + to_string(page_size);
+        const auto start = Clock::now();
+        const auto pages = Paginate(document_ids, page_size);
+        size_t page_count = 0;
+        for (const auto& page : pages) {
+            page_count += page.begin() != page.end();
+        }
+        const auto finish = Clock::now();
+        report.AddMetric(benchmark, "seconds", GetSeconds(start, finish));
+        report.AddMetric(benchmark, "pages", static_cast<double>(page_count));
+    }
+}
+
+// The queries are sent twice, so the second round is served from the cache as far
+// as it holds them.
+void BenchmarkRequestQueue(BenchmarkReport& report, const Corpus& corpus, const SearchServer& search_server) {
+    RequestQueue request_queue(search_server);
+    vector<uint64_t> latencies;
+    latencies.reserve(corpus.queries.size() * 2);
+    for (int round = 0; round < 2; ++round) {
+        for (const string& query : corpus.queries) {
+            const auto start = Clock::now();
+            request_queue.AddFindRequest(query);
+            latencies.push_back(GetNanoseconds(start, Clock::now()));
+        }
+    }
+    report.AddLatencies("request_queue", move(latencies));
+    report.AddMetric("request_queue", "cache_hits", static_cast<double>(request_queue.GetCacheHits()));
+    report.AddMetric("request_queue", "cache_misses", static_cast<double>(request_queue.GetCacheMisses()));
+    report.AddMetric("request_queue", "no_result_requests", static_cast<double>(request_queue.GetNoResultRequests()));
+}
+
+void BenchmarkConcurrentRequestQueue(BenchmarkReport& report, const Corpus& corpus, const SearchServer& search_server) {
+    ConcurrentRequestQueue request_queue(search_server);
+    const auto start = Clock::now();
+    for_each(execution::par, corpus.queries.begin(), corpus.queries.end(), [&request_queue](const string& query) {
+        request_queue.AddFindRequest(query);
+        });
+    const auto finish = Clock::now();
+    const ConcurrentRequestQueue::WindowStatistics statistics = request_queue.GetStatistics();
+    report.AddMetric("concurrent_request_queue", "seconds", GetSeconds(start, finish));
+    report.AddMetric("concurrent_request_queue", "queries_per_second", round(static_cast<double>(corpus.queries.size()) / GetSeconds(start, finish)));
+    report.AddMetric("concurrent_request_queue", "window_requests", static_cast<double>(statistics.request_count));
+    report.AddMetric("concurrent_request_queue", "no_result_requests", static_cast<double>(statistics.no_result_request_count));
+}
+
+// SearchServer keeps the best MAX_RESULT_DOCUMENT_COUNT results with partial_sort;
+// this compares it with a full sort and with nth_element followed by a sort of the
+// head, over result sets of 10 to max_top_k_size documents. Every size is run often
+// enough to select from about max_top_k_size documents in total.
+void BenchmarkTopKSelection(BenchmarkReport& report, size_t max_top_k_size) {
+    BenchmarkRandom random(max_top_k_size);
+    for (size_t size = 10; size <= max_top_k_size; size *= 10) {
+        vector<Document> documents(size);
+        for (size_t i = 0; i < size; ++i) {
+            documents[i] = Document(static_cast<int>(i), random.NextDouble(), static_cast<int>(random.NextIndex(21)) - 10);
+        }
+        const size_t repetitions = max<size_t>(max_top_k_size / size, 1);
+        const size_t top_k = min<size_t>(MAX_RESULT_DOCUMENT_COUNT, size);
+        const auto top_end = [top_k](vector<Document>& selected) {
+            return selected.begin() + static_cast<ptrdiff_t>(top_k);
+        };
+        const auto run = [&](const string& method, auto select) {
+            uint64_t nanoseconds = 0;
+            vector<Document> selected;
+            for (size_t repetition = 0; repetition < repetitions; ++repetition) {
+                selected = documents;
+                const auto start = Clock::now();
+                select(selected);
+                nanoseconds += GetNanoseconds(start, Clock::now());
+            }
+            report.AddMetric("top_k_selection_"s + to_string(size), method + "_ns"s, round(static_cast<double>(nanoseconds) / static_cast<double>(repetitions)));
+        };
+        run("partial_sort"s, [&](vector<Document>& selected) {
+            partial_sort(selected.begin(), top_end(selected), selected.end(), SearchServer::IsMoreRelevant);
+            });
+        run("nth_element"s, [&](vector<Document>& selected) {
+            nth_element(selected.begin(), top_end(selected) - 1, selected.end(), SearchServer::IsMoreRelevant);
+            sort(selected.begin(), top_end(selected), SearchServer::IsMoreRelevant);
+            });
+        run("sort"s, [&](vector<Document>& selected) {
+            sort(selected.begin(), selected.end(), SearchServer::IsMoreRelevant);
+            });
+    }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    try {
+        options = ParseOptions(argc, argv);
+    }
+    catch (const exception& error) {
+        cerr << "search_server_benchmark: "s << error.what() << endl;
+        return 1;
+    }
+    BenchmarkReport report;
+    AddConfig(report, options);
+
+    const Corpus corpus = GenerateCorpus(options.corpus);
+    SearchServer search_server(corpus.stop_words);
+    BenchmarkAddDocument(report, corpus, search_server);
+    BenchmarkAddDocuments(report, corpus);
+    search_server.MergeSegments();
+    BenchmarkQueries(report, "find_top_documents"s, corpus, [&search_server](const string& query) {
+        return search_server.FindTopDocuments(query);
+        });
+    BenchmarkQueries(report, "find_top_documents_par"s, corpus, [&search_server](const string& query) {
+        return search_server.FindTopDocuments(execution::par, query);
+        });
+    BenchmarkMatchDocument(report, corpus, search_server);
+    BenchmarkPaginate(report, search_server);
+    BenchmarkRequestQueue(report, corpus, search_server);
+    BenchmarkConcurrentRequestQueue(report, corpus, search_server);
+    BenchmarkTopKSelection(report, options.max_top_k_size);
+
+    if (options.output_path.empty()) {
+        report.Write(cout);
+    }
+    else {
+        ofstream output(options.output_path);
+        report.Write(output);
+        if (!output) {
+            cerr << "search_server_benchmark: cannot write "s << options.output_path << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "benchmark_report.h"
+
+using namespace std;
+
+namespace {
+
+void WriteMetrics(ostream& output, const vector<pair<string, double>>& metrics, const char* indent) {
+    output << "{";
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        output << (i == 0 ? "\n" : ",\n") << indent << "  \"" << metrics[i].first << "\": ";
+        const double value = metrics[i].second;
+        if (value == floor(value) && abs(value) < 9007199254740992.0) {
+            output << static_cast<int64_t>(value);
+        }
+        else {
+            output << setprecision(6) << value;
+        }
+    }
+    output << "\n" << indent << "}";
+}
+
+}
+
+void BenchmarkReport::AddConfig(const string& name, double value) {
+    config_.emplace_back(name, value);
+}
+
+void BenchmarkReport::AddMetric(const string& benchmark, const string& name, double value) {
+    GetBenchmark(benchmark).emplace_back(name, value);
+}
+
+void BenchmarkReport::AddLatencies(const string& benchmark, vector<uint64_t> nanoseconds) {
+    Metrics& metrics = GetBenchmark(benchmark);
+    metrics.emplace_back("count", static_cast<double>(nanoseconds.size()));
+    if (nanoseconds.empty()) {
+        return;
+    }
+    sort(nanoseconds.begin(), nanoseconds.end());
+    double sum = 0.0;
+    for (const uint64_t latency : nanoseconds) {
+        sum += static_cast<double>(latency);
+    }
+    const auto percentile = [&nanoseconds](double percent) {
+        const size_t rank = static_cast<size_t>(ceil(percent / 100.0 * static_cast<double>(nanoseconds.size())));
+        return static_cast<double>(nanoseconds[max<size_t>(rank, 1) - 1]);
+    };
+    metrics.emplace_back("mean_ns", round(sum / static_cast<double>(nanoseconds.size())));
+    metrics.emplace_back("p50_ns", percentile(50.0));
+    metrics.emplace_back("p90_ns", percentile(90.0));
+    metrics.emplace_back("p99_ns", percentile(99.0));
+    metrics.emplace_back("p99_9_ns", percentile(99.9));
+    metrics.emplace_back("max_ns", static_cast<double>(nanoseconds.back()));
+}
+
+void BenchmarkReport::Write(ostream& output) const {
+    output << "{\n  \"config\": ";
+    WriteMetrics(output, config_, "  ");
+    output << ",\n  \"benchmarks\": {";
+    for (size_t i = 0; i < benchmarks_.size(); ++i) {
+        output << (i == 0 ? "\n" : ",\n") << "    \"" << benchmarks_[i].first << "\": ";
+        WriteMetrics(output, benchmarks_[i].second, "    ");
+    }
+    output << "\n  }\n}\n";
+}
+
+BenchmarkReport::Metrics& BenchmarkReport::GetBenchmark(const string& benchmark) {
+    const auto benchmark_it = find_if(benchmarks_.begin(), benchmarks_.end(), [&benchmark](const pair<string, Metrics>& entry) {
+        return entry.first == benchmark;
+        });
+    if (benchmark_it != benchmarks_.end()) {
+        return benchmark_it->second;
+    }
+    return benchmarks_.emplace_back(benchmark, Metrics()).second;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Metrics of the benchmarks, written as JSON with a fixed order of benchmarks and
+// metrics, so the reports of two releases can be diffed line by line.
+class BenchmarkReport {
+public:
+    void AddConfig(const std::string& name, double value);
+    void AddMetric(const std::string& benchmark, const std::string& name, double value);
+    // Adds count, mean, p50, p90, p99, p99.9 and max of the latencies in nanoseconds.
+    void AddLatencies(const std::string& benchmark, std::vector<uint64_t> nanoseconds);
+
+    void Write(std::ostream& output) const;
+
+private:
+    using Metrics = std::vector<std::pair<std::string, double>>;
+
+    Metrics config_;
+    std::vector<std::pair<std::string, Metrics>> benchmarks_;
+
+    Metrics& GetBenchmark(const std::string& benchmark);
+};
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cmath>
+
+#include "corpus_generator.h"
+
+using namespace std;
+
+namespace {
+
+// Word of rank 0 is "a", then "b", ..., "z", "aa", "ab", ...
+string MakeWord(size_t rank) {
+    string word;
+    ++rank;
+    while (rank > 0) {
+        --rank;
+        word += static_cast<char>('a' + rank % 26);
+        rank /= 26;
+    }
+    return word;
+}
+
+size_t NextLength(BenchmarkRandom& random, size_t min_length, size_t max_length) {
+    return min_length + random.NextIndex(max_length - min_length + 1);
+}
+
+}
+
+BenchmarkRandom::BenchmarkRandom(uint64_t seed)
+    : state_(seed)
+{
+}
+
+uint64_t BenchmarkRandom::Next() {
+    uint64_t value = (state_ += 0x9E3779B97F4A7C15ull);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+double BenchmarkRandom::NextDouble() {
+    return static_cast<double>(Next() >> 11) / static_cast<double>(uint64_t{ 1 } << 53);
+}
+
+size_t BenchmarkRandom::NextIndex(size_t bound) {
+    return static_cast<size_t>(NextDouble() * static_cast<double>(bound));
+}
+
+ZipfianDistribution::ZipfianDistribution(size_t value_count, double exponent) {
+    cumulative_probabilities_.reserve(value_count);
+    double sum = 0.0;
+    for (size_t rank = 0; rank < value_count; ++rank) {
+        sum += 1.0 / pow(static_cast<double>(rank + 1), exponent);
+        cumulative_probabilities_.push_back(sum);
+    }
+    for (double& probability : cumulative_probabilities_) {
+        probability /= sum;
+    }
+}
+
+size_t ZipfianDistribution::operator()(BenchmarkRandom& random) const {
+    const auto rank_it = upper_bound(cumulative_probabilities_.begin(), cumulative_probabilities_.end(), random.NextDouble());
+    return min(static_cast<size_t>(rank_it - cumulative_probabilities_.begin()), cumulative_probabilities_.size() - 1);
+}
+
+// Stop words are spelled in upper case, so they never collide with the vocabulary.
+Corpus GenerateCorpus(const CorpusConfig& config) {
+    BenchmarkRandom random(config.seed);
+    const ZipfianDistribution word_distribution(config.vocabulary_size, config.zipf_exponent);
+    Corpus corpus;
+    for (size_t i = 0; i < config.stop_word_count; ++i) {
+        string stop_word = MakeWord(i);
+        transform(stop_word.begin(), stop_word.end(), stop_word.begin(), [](char c) {
+            return static_cast<char>(c - 'a' + 'A');
+            });
+        corpus.stop_words.push_back(move(stop_word));
+    }
+    vector<string> vocabulary;
+    vocabulary.reserve(config.vocabulary_size);
+    for (size_t rank = 0; rank < config.vocabulary_size; ++rank) {
+        vocabulary.push_back(MakeWord(rank));
+    }
+    const auto next_word = [&]() -> const string& {
+        if (!corpus.stop_words.empty() && random.NextDouble() < config.stop_word_ratio) {
+            return corpus.stop_words[random.NextIndex(corpus.stop_words.size())];
+        }
+        return vocabulary[word_distribution(random)];
+    };
+
+    corpus.documents.reserve(config.document_count);
+    for (size_t i = 0; i < config.document_count; ++i) {
+        const size_t length = NextLength(random, config.min_document_length, config.max_document_length);
+        string document;
+        for (size_t j = 0; j < length; ++j) {
+            if (j > 0) {
+                document += ' ';
+            }
+            document += next_word();
+        }
+        corpus.documents.push_back(move(document));
+        const double status_draw = random.NextDouble();
+        corpus.statuses.push_back(status_draw < 0.85 ? DocumentStatus::ACTUAL
+            : status_draw < 0.9 ? DocumentStatus::IRRELEVANT
+            : status_draw < 0.95 ? DocumentStatus::BANNED : DocumentStatus::REMOVED);
+        vector<int> ratings(1 + random.NextIndex(5));
+        for (int& rating : ratings) {
+            rating = static_cast<int>(random.NextIndex(21)) - 10;
+        }
+        corpus.ratings.push_back(move(ratings));
+    }
+
+    corpus.queries.reserve(config.query_count);
+    for (size_t i = 0; i < config.query_count; ++i) {
+        const size_t length = NextLength(random, config.min_query_length, config.max_query_length);
+        string query;
+        for (size_t j = 0; j < length; ++j) {
+            if (j > 0) {
+                query += ' ';
+                if (random.NextDouble() < config.minus_word_ratio) {
+                    query += '-';
+                }
+            }
+            query += next_word();
+        }
+        corpus.queries.push_back(move(query));
+    }
+    return corpus;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../document.h"
+
+// splitmix64. The <random> distributions differ between standard libraries, so the
+// corpus is drawn from this generator alone to be the same everywhere.
+class BenchmarkRandom {
+public:
+    explicit BenchmarkRandom(uint64_t seed);
+
+    uint64_t Next();
+    // Uniform in [0, 1).
+    double NextDouble();
+    // Uniform in [0, bound).
+    size_t NextIndex(size_t bound);
+
+private:
+    uint64_t state_;
+};
+
+// Draws ranks in [0, value_count) with probability proportional to 1 / (rank + 1)^exponent.
+class ZipfianDistribution {
+public:
+    ZipfianDistribution(size_t value_count, double exponent);
+
+    size_t operator()(BenchmarkRandom& random) const;
+
+private:
+    std::vector<double> cumulative_probabilities_;
+};
+
+struct CorpusConfig {
+    uint64_t seed = 42;
+    size_t document_count = 100000;
+    size_t vocabulary_size = 50000;
+    double zipf_exponent = 1.0;
+    size_t min_document_length = 20;
+    size_t max_document_length = 80;
+    size_t stop_word_count = 20;
+    // Share of document and query words that are stop words.
+    double stop_word_ratio = 0.2;
+    size_t query_count = 2000;
+    size_t min_query_length = 1;
+    size_t max_query_length = 5;
+    // Share of query words after the first that are minus words.
+    double minus_word_ratio = 0.2;
+};
+
+// Documents have ids 0, 1, ... in order.
+struct Corpus {
+    std::vector<std::string> stop_words;
+    std::vector<std::string> documents;
+    std::vector<DocumentStatus> statuses;
+    std::vector<std::vector<int>> ratings;
+    std::vector<std::string> queries;
+};
+
+Corpus GenerateCorpus(const CorpusConfig& config);
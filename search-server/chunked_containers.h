@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Copy-on-write containers for the tables of SearchServer. The elements live in
+// chunks held by shared_ptr, so a copy of a container copies only the chunk
+// pointers and shares the chunks with the original. A change copies the one chunk
+// it touches if another container still shares it.
+
+// Gives the caller the only reference to *chunk, copying the chunk if another
+// container shares it. A container is changed only by the thread that owns it, and
+// other owners of the chunk can only drop their references meanwhile, so a use count
+// of one cannot grow; the fence orders the caller's writes after those owners' last
+// reads of the chunk.
+template <typename Chunk>
+Chunk& MakeUniqueChunk(std::shared_ptr<Chunk>& chunk) {
+    if (chunk.use_count() > 1) {
+        chunk = std::make_shared<Chunk>(*chunk);
+    }
+    else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *chunk;
+}
+
+// A vector split into chunks of ChunkSize elements.
+template <typename Value, size_t ChunkSize>
+class ChunkedVector {
+public:
+    size_t GetSize() const {
+        return size_;
+    }
+
+    const Value& operator[](size_t index) const {
+        return (*chunks_[index / ChunkSize])[index % ChunkSize];
+    }
+
+    Value& GetMutable(size_t index) {
+        return MakeUniqueChunk(chunks_[index / ChunkSize])[index % ChunkSize];
+    }
+
+    void PushBack(Value value) {
+        if (size_ % ChunkSize == 0) {
+            chunks_.push_back(std::make_shared<Chunk>());
+            chunks_.back()->reserve(ChunkSize);
+        }
+        MakeUniqueChunk(chunks_.back()).push_back(std::move(value));
+        ++size_;
+    }
+
+    void Clear() {
+        chunks_.clear();
+        size_ = 0;
+    }
+
+    size_t GetChunkCount() const {
+        return chunks_.size();
+    }
+
+    size_t CountSharedChunks(const ChunkedVector& other) const {
+        size_t shared_chunk_count = 0;
+        for (size_t i = 0; i < std::min(chunks_.size(), other.chunks_.size()); ++i) {
+            shared_chunk_count += chunks_[i] == other.chunks_[i] ? 1 : 0;
+        }
+        return shared_chunk_count;
+    }
+
+private:
+    using Chunk = std::vector<Value>;
+
+    std::vector<std::shared_ptr<Chunk>> chunks_;
+    size_t size_ = 0;
+};
+
+// A map sorted by key and split into leaves of up to LeafSize entries; a full leaf
+// is split in two on insertion. Finding the leaf of a key is a binary search over
+// the first keys of the leaves.
+template <typename Key, typename Value, size_t LeafSize, typename Less = std::less<Key>>
+class ChunkedMap {
+private:
+    using Entry = std::pair<Key, Value>;
+    using Leaf = std::vector<Entry>;
+
+public:
+    // Iterates over the keys in ascending order.
+    class KeyIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Key;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Key*;
+        using reference = const Key&;
+
+        KeyIterator() = default;
+
+        reference operator*() const {
+            return (*(*leaves_)[leaf_index_])[position_].first;
+        }
+
+        pointer operator->() const {
+            return &**this;
+        }
+
+        KeyIterator& operator++() {
+            if (++position_ == (*leaves_)[leaf_index_]->size()) {
+                ++leaf_index_;
+                position_ = 0;
+            }
+            return *this;
+        }
+
+        KeyIterator operator++(int) {
+            KeyIterator iterator = *this;
+            ++*this;
+            return iterator;
+        }
+
+        friend bool operator==(const KeyIterator& lhs, const KeyIterator& rhs) {
+            return lhs.leaf_index_ == rhs.leaf_index_ && lhs.position_ == rhs.position_;
+        }
+
+        friend bool operator!=(const KeyIterator& lhs, const KeyIterator& rhs) {
+            return !(lhs == rhs);
+        }
+
+    private:
+        friend class ChunkedMap;
+
+        KeyIterator(const std::vector<std::shared_ptr<Leaf>>* leaves, size_t leaf_index)
+            : leaves_(leaves)
+            , leaf_index_(leaf_index)
+        {
+        }
+
+        const std::vector<std::shared_ptr<Leaf>>* leaves_ = nullptr;
+        size_t leaf_index_ = 0;
+        size_t position_ = 0;
+    };
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+    // Returns nullptr if the key is absent.
+    const Value* Find(const Key& key) const {
+        if (leaves_.empty()) {
+            return nullptr;
+        }
+        const Leaf& leaf = *leaves_[FindLeaf(key)];
+        const auto entry_it = LowerBound(leaf, key);
+        return entry_it != leaf.end() && !Less()(key, entry_it->first) ? &entry_it->second : nullptr;
+    }
+
+    // Returns false and leaves the map unchanged if the key is present.
+    bool Insert(const Key& key, Value value) {
+        if (leaves_.empty()) {
+            leaves_.push_back(std::make_shared<Leaf>());
+        }
+        const size_t leaf_index = FindLeaf(key);
+        const Leaf& shared_leaf = *leaves_[leaf_index];
+        const auto shared_entry_it = LowerBound(shared_leaf, key);
+        if (shared_entry_it != shared_leaf.end() && !Less()(key, shared_entry_it->first)) {
+            return false;
+        }
+        const auto position = shared_entry_it - shared_leaf.begin();
+        Leaf& leaf = MakeUniqueChunk(leaves_[leaf_index]);
+        leaf.insert(leaf.begin() + position, { key, std::move(value) });
+        ++size_;
+        if (leaf.size() > LeafSize) {
+            const auto middle = leaf.begin() + static_cast<std::ptrdiff_t>(leaf.size() / 2);
+            auto upper_leaf = std::make_shared<Leaf>(std::make_move_iterator(middle), std::make_move_iterator(leaf.end()));
+            leaf.erase(middle, leaf.end());
+            leaves_.insert(leaves_.begin() + static_cast<std::ptrdiff_t>(leaf_index) + 1, std::move(upper_leaf));
+        }
+        return true;
+    }
+
+    // Returns false if the key is absent.
+    bool Erase(const Key& key) {
+        if (leaves_.empty()) {
+            return false;
+        }
+        const size_t leaf_index = FindLeaf(key);
+        const Leaf& shared_leaf = *leaves_[leaf_index];
+        const auto shared_entry_it = LowerBound(shared_leaf, key);
+        if (shared_entry_it == shared_leaf.end() || Less()(key, shared_entry_it->first)) {
+            return false;
+        }
+        const auto position = shared_entry_it - shared_leaf.begin();
+        Leaf& leaf = MakeUniqueChunk(leaves_[leaf_index]);
+        leaf.erase(leaf.begin() + position);
+        --size_;
+        if (leaf.empty()) {
+            leaves_.erase(leaves_.begin() + static_cast<std::ptrdiff_t>(leaf_index));
+        }
+        return true;
+    }
+
+    // Replaces the contents with entries, which must be sorted by key without duplicates.
+    void Assign(std::vector<Entry> entries) {
+        leaves_.clear();
+        for (size_t leaf_begin = 0; leaf_begin < entries.size(); leaf_begin += LeafSize) {
+            const auto begin = entries.begin() + static_cast<std::ptrdiff_t>(leaf_begin);
+            const auto end = entries.begin() + static_cast<std::ptrdiff_t>(std::min(leaf_begin + LeafSize, entries.size()));
+            leaves_.push_back(std::make_shared<Leaf>(std::make_move_iterator(begin), std::make_move_iterator(end)));
+        }
+        size_ = entries.size();
+    }
+
+    // Calls handle_entry(key, value) for every entry in ascending key order.
+    template <typename EntryHandler>
+    void ForEach(EntryHandler handle_entry) const {
+        for (const std::shared_ptr<Leaf>& leaf : leaves_) {
+            for (const auto& [key, value] : *leaf) {
+                handle_entry(key, value);
+            }
+        }
+    }
+
+    KeyIterator KeysBegin() const {
+        return KeyIterator(&leaves_, 0);
+    }
+
+    KeyIterator KeysEnd() const {
+        return KeyIterator(&leaves_, leaves_.size());
+    }
+
+    size_t GetChunkCount() const {
+        return leaves_.size();
+    }
+
+    // Leaves are matched by identity, as a split moves the leaves after it.
+    size_t CountSharedChunks(const ChunkedMap& other) const {
+        std::unordered_set<const Leaf*> other_leaves;
+        for (const std::shared_ptr<Leaf>& leaf : other.leaves_) {
+            other_leaves.insert(leaf.get());
+        }
+        return static_cast<size_t>(std::count_if(leaves_.begin(), leaves_.end(), [&other_leaves](const std::shared_ptr<Leaf>& leaf) {
+            return other_leaves.count(leaf.get()) > 0;
+            }));
+    }
+
+private:
+    std::vector<std::shared_ptr<Leaf>> leaves_;
+    size_t size_ = 0;
+
+    // The last leaf whose first key is not greater than key, or the first leaf.
+    size_t FindLeaf(const Key& key) const {
+        const auto leaf_it = std::upper_bound(leaves_.begin() + 1, leaves_.end(), key,
+            [](const Key& value, const std::shared_ptr<Leaf>& leaf) {
+                return Less()(value, leaf->front().first);
+            });
+        return static_cast<size_t>(leaf_it - leaves_.begin()) - 1;
+    }
+
+    static typename Leaf::const_iterator LowerBound(const Leaf& leaf, const Key& key) {
+        return std::lower_bound(leaf.begin(), leaf.end(), key,
+            [](const Entry& entry, const Key& value) {
+                return Less()(entry.first, value);
+            });
+    }
+};
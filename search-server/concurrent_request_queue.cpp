@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <limits>
+
+#include "concurrent_request_queue.h"
+
+using namespace std;
+
+ConcurrentRequestQueue::ConcurrentRequestQueue(const SearchServer& search_server)
+    : search_server_(&search_server)
+    , slots_(REQUEST_WINDOW_SIZE)
+{
+}
+
+ConcurrentRequestQueue::ConcurrentRequestQueue(const VersionedSearchServer& search_server)
+    : versioned_search_server_(&search_server)
+    , slots_(REQUEST_WINDOW_SIZE)
+{
+}
+
+vector<Document> ConcurrentRequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
+    return AddFindRequest(raw_query, [status](int id, DocumentStatus document_status, int average_document_rating) {
+        return status == document_status;
+        });
+}
+
+vector<Document> ConcurrentRequestQueue::AddFindRequest(const string& raw_query) {
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
+}
+
+// The request is counted before the exchange, and the exchange is acq_rel: the
+// writer that fills a slot releases its additions, and the writer that replaces the
+// request acquires them before subtracting it. Every subtraction thus comes after
+// the matching addition in the modification order of each counter, so no reader
+// can see a counter wrap below zero.
+void ConcurrentRequestQueue::RecordRequest(size_t result_document_count, chrono::nanoseconds latency) {
+    const uint64_t request = RECORDED_BIT | (static_cast<uint64_t>(GetLatencyBucket(latency)) << 32)
+        | min<uint64_t>(result_document_count, numeric_limits<uint32_t>::max());
+    CountRequest(request, true);
+    const uint64_t slot_index = next_slot_.fetch_add(1, memory_order_relaxed) % slots_.size();
+    const uint64_t replaced_request = slots_[slot_index].exchange(request, memory_order_acq_rel);
+    if (replaced_request != 0) {
+        CountRequest(replaced_request, false);
+    }
+}
+
+ConcurrentRequestQueue::WindowStatistics ConcurrentRequestQueue::GetStatistics() const {
+    WindowStatistics statistics;
+    statistics.request_count = request_count_.load(memory_order_relaxed);
+    statistics.no_result_request_count = no_result_request_count_.load(memory_order_relaxed);
+    statistics.result_document_count = result_document_count_.load(memory_order_relaxed);
+    for (size_t bucket = 0; bucket < LATENCY_BUCKET_COUNT; ++bucket) {
+        statistics.latency_bucket_counts[bucket] = latency_bucket_counts_[bucket].load(memory_order_relaxed);
+    }
+    return statistics;
+}
+
+int ConcurrentRequestQueue::GetNoResultRequests() const {
+    return static_cast<int>(no_result_request_count_.load(memory_order_relaxed));
+}
+
+size_t ConcurrentRequestQueue::GetLatencyBucket(chrono::nanoseconds latency) {
+    const auto microseconds = chrono::duration_cast<chrono::microseconds>(latency).count();
+    size_t bucket = 0;
+    while (bucket + 1 < LATENCY_BUCKET_COUNT && (int64_t{ 1 } << bucket) <= microseconds) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+shared_ptr<const SearchServer> ConcurrentRequestQueue::GetSearchServer() const {
+    if (versioned_search_server_ != nullptr) {
+        return versioned_search_server_->GetSnapshot();
+    }
+    return shared_ptr<const SearchServer>(shared_ptr<const SearchServer>(), search_server_);
+}
+
+void ConcurrentRequestQueue::CountRequest(uint64_t request, bool is_added) {
+    const auto count = [is_added](atomic<size_t>& counter, size_t value) {
+        if (is_added) {
+            counter.fetch_add(value, memory_order_relaxed);
+        }
+        else {
+            counter.fetch_sub(value, memory_order_relaxed);
+        }
+    };
+    const size_t result_document_count = static_cast<size_t>(request & numeric_limits<uint32_t>::max());
+    count(request_count_, 1);
+    count(no_result_request_count_, result_document_count == 0 ? 1 : 0);
+    count(result_document_count_, result_document_count);
+    count(latency_bucket_counts_[static_cast<size_t>((request & ~RECORDED_BIT) >> 32)], 1);
+}
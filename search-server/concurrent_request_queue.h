@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "versioned_search_server.h"
+
+const size_t REQUEST_WINDOW_SIZE = 1440;
+const size_t LATENCY_BUCKET_COUNT = 24;
+
+// Statistics of the last REQUEST_WINDOW_SIZE requests that any number of threads
+// can record and read without locks. Every request is packed into one atomic slot of
+// a ring; a writer counts its request into the window counters first and then
+// exchanges it into the next slot, subtracting whatever request it replaced. The
+// counters may include requests that are still being recorded, so while writers
+// run a snapshot can briefly exceed the window, but it never misses a request
+// that is in the ring. Results are not cached, unlike in RequestQueue.
+class ConcurrentRequestQueue {
+public:
+    explicit ConcurrentRequestQueue(const SearchServer& search_server);
+    explicit ConcurrentRequestQueue(const VersionedSearchServer& search_server);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
+    std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
+    std::vector<Document> AddFindRequest(const std::string& raw_query);
+
+    // Records a request that was served without the queue.
+    void RecordRequest(size_t result_document_count, std::chrono::nanoseconds latency);
+
+    struct WindowStatistics {
+        size_t request_count = 0;
+        size_t no_result_request_count = 0;
+        size_t result_document_count = 0;
+        std::array<size_t, LATENCY_BUCKET_COUNT> latency_bucket_counts = {};
+    };
+
+    WindowStatistics GetStatistics() const;
+    int GetNoResultRequests() const;
+
+    // Bucket 0 holds latencies under 1 us, bucket i those in [2^(i-1), 2^i) us, and
+    // the last bucket everything longer.
+    static size_t GetLatencyBucket(std::chrono::nanoseconds latency);
+
+private:
+    const SearchServer* search_server_ = nullptr;
+    const VersionedSearchServer* versioned_search_server_ = nullptr;
+
+    // A slot holds 0 until it is first written; a request is packed with a set
+    // RECORDED_BIT, its latency bucket above bit 32 and its result count below.
+    static constexpr uint64_t RECORDED_BIT = uint64_t{ 1 } << 63;
+    std::vector<std::atomic<uint64_t>> slots_;
+    std::atomic<uint64_t> next_slot_{ 0 };
+    std::atomic<size_t> request_count_{ 0 };
+    std::atomic<size_t> no_result_request_count_{ 0 };
+    std::atomic<size_t> result_document_count_{ 0 };
+    std::array<std::atomic<size_t>, LATENCY_BUCKET_COUNT> latency_bucket_counts_ = {};
+
+    std::shared_ptr<const SearchServer> GetSearchServer() const;
+    void CountRequest(uint64_t request, bool is_added);
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> ConcurrentRequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Document> documents_found = GetSearchServer()->FindTopDocuments(raw_query, document_predicate);
+    RecordRequest(documents_found.size(), std::chrono::steady_clock::now() - start);
+    return documents_found;
+}
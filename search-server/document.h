@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 struct Document {
     Document(const int& create_server_id, const double& create_server_relevance, const int& create_server_rating);
@@ -17,6 +21,22 @@ enum class DocumentStatus {
     REMOVED
 };
 
+// A document for SearchServer::AddDocuments. The text only has to outlive the call.
+struct NewDocument {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+// A document AddDocuments did not add: position is its index in the batch, and
+// reason is the message AddDocument would have thrown.
+struct RejectedDocument {
+    size_t position = 0;
+    int id = 0;
+    std::string reason;
+};
+
 void PrintDocument(const Document& document);
 
 std::ostream& operator<<(std::ostream& os, const Document& document);
@@ -0,0 +1,129 @@
+#include "index_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const string& path) {
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        throw runtime_error("cannot open index file "s + path);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_, &file_size)) {
+        CloseHandle(file_);
+        throw runtime_error("cannot read index file "s + path);
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    if (size_ == 0) {
+        return;
+    }
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    data_ = mapping_ != nullptr ? static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    if (data_ == nullptr) {
+        if (mapping_ != nullptr) {
+            CloseHandle(mapping_);
+        }
+        CloseHandle(file_);
+        throw runtime_error("cannot map index file "s + path);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr) {
+        CloseHandle(mapping_);
+    }
+    if (file_ != nullptr) {
+        CloseHandle(file_);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const string& path) {
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw runtime_error("cannot open index file "s + path);
+    }
+    struct stat file_status;
+    if (fstat(file, &file_status) != 0) {
+        close(file);
+        throw runtime_error("cannot read index file "s + path);
+    }
+    size_ = static_cast<size_t>(file_status.st_size);
+    if (size_ != 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file, 0);
+        if (data == MAP_FAILED) {
+            close(file);
+            throw runtime_error("cannot map index file "s + path);
+        }
+        data_ = static_cast<const char*>(data);
+    }
+    close(file);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+#endif
+
+const char* MappedFile::GetData() const {
+    return data_;
+}
+
+size_t MappedFile::GetSize() const {
+    return size_;
+}
+
+void WriteIndexStrings(ostream& output, const vector<string_view>& strings) {
+    vector<uint64_t> offsets = { 0 };
+    offsets.reserve(strings.size() + 1);
+    for (const string_view text : strings) {
+        offsets.push_back(offsets.back() + text.size());
+    }
+    WriteIndexArray(output, offsets.data(), offsets.size());
+    string characters;
+    characters.reserve(static_cast<size_t>(offsets.back()));
+    for (const string_view text : strings) {
+        characters += text;
+    }
+    WriteIndexArray(output, characters.data(), characters.size());
+}
+
+vector<string_view> IndexFileReader::ReadStrings(size_t count) {
+    if (count >= (size_ - offset_) / sizeof(uint64_t)) {
+        throw runtime_error("index file is truncated"s);
+    }
+    const uint64_t* offsets = ReadArray<uint64_t>(count + 1);
+    if (offsets[0] != 0) {
+        throw runtime_error("index file has malformed strings"s);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (offsets[i] > offsets[i + 1]) {
+            throw runtime_error("index file has malformed strings"s);
+        }
+    }
+    const char* characters = ReadArray<char>(static_cast<size_t>(offsets[count]));
+    vector<string_view> strings;
+    strings.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        strings.emplace_back(characters + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i]));
+    }
+    return strings;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+using namespace std::literals::string_literals;
+
+// Read-only memory mapping of a whole file, unmapped on destruction.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const char* GetData() const;
+    size_t GetSize() const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+// Sections of the index file are arrays of trivially copyable values, each one
+// starting at an offset aligned to INDEX_FILE_ALIGNMENT, so a mapped file can be
+// read through typed pointers without copying.
+const size_t INDEX_FILE_ALIGNMENT = 8;
+
+template <typename Value>
+void WriteIndexArray(std::ostream& output, const Value* values, size_t count) {
+    static_assert(std::is_trivially_copyable_v<Value>, "index file sections must be trivially copyable");
+    const size_t byte_count = sizeof(Value) * count;
+    if (byte_count != 0) {
+        output.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(byte_count));
+    }
+    const char padding[INDEX_FILE_ALIGNMENT] = {};
+    output.write(padding, static_cast<std::streamsize>((INDEX_FILE_ALIGNMENT - byte_count % INDEX_FILE_ALIGNMENT) % INDEX_FILE_ALIGNMENT));
+}
+
+template <typename Value>
+void WriteIndexValue(std::ostream& output, const Value& value) {
+    WriteIndexArray(output, &value, 1);
+}
+
+// Writes count + 1 offsets followed by the concatenated characters.
+void WriteIndexStrings(std::ostream& output, const std::vector<std::string_view>& strings);
+
+class IndexFileReader {
+public:
+    IndexFileReader(const char* data, size_t size)
+        : data_(data)
+        , size_(size)
+    {
+    }
+
+    template <typename Value>
+    const Value* ReadArray(size_t count) {
+        static_assert(std::is_trivially_copyable_v<Value>, "index file sections must be trivially copyable");
+        if (count > (size_ - offset_) / sizeof(Value)) {
+            throw std::runtime_error("index file is truncated"s);
+        }
+        const Value* values = reinterpret_cast<const Value*>(data_ + offset_);
+        const size_t byte_count = sizeof(Value) * count;
+        offset_ += byte_count + (INDEX_FILE_ALIGNMENT - byte_count % INDEX_FILE_ALIGNMENT) % INDEX_FILE_ALIGNMENT;
+        offset_ = offset_ < size_ ? offset_ : size_;
+        return values;
+    }
+
+    template <typename Value>
+    const Value& ReadValue() {
+        return *ReadArray<Value>(1);
+    }
+
+    // Views into the read memory; they live as long as the memory does.
+    std::vector<std::string_view> ReadStrings(size_t count);
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+};
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <limits>
+
+#include "index_segment.h"
+
+using namespace std;
+
+namespace {
+
+void AppendVarint(vector<uint8_t>& data, uint32_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+// Returns nullptr if the varint runs past end.
+const uint8_t* ReadVarint(const uint8_t* position, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; position != end && shift < 32; shift += 7) {
+        const uint8_t byte = *position++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return position;
+        }
+    }
+    return nullptr;
+}
+
+}
+
+IndexSegment::IndexSegment(int ordinal_begin, int ordinal_end)
+    : ordinal_begin_(ordinal_begin)
+    , ordinal_end_(ordinal_end)
+{
+}
+
+IndexSegment::IndexSegment(int ordinal_begin, int ordinal_end, const unordered_map<int, vector<Posting>>& postings_by_term,
+    const vector<int>& word_counts, const vector<bool>& is_removed)
+    : IndexSegment(ordinal_begin, ordinal_end)
+{
+    vector<int> term_ids;
+    term_ids.reserve(postings_by_term.size());
+    for (const auto& [term_id, postings] : postings_by_term) {
+        term_ids.push_back(term_id);
+    }
+    sort(term_ids.begin(), term_ids.end());
+    for (const int term_id : term_ids) {
+        for (const Posting& posting : postings_by_term.at(term_id)) {
+            AppendPosting(posting, is_removed);
+        }
+        CloseTerm(term_id);
+    }
+    owned_word_counts_ = word_counts;
+    BindOwnedArrays();
+}
+
+shared_ptr<const IndexSegment> IndexSegment::Merge(const IndexSegment& older, const IndexSegment& newer, const vector<bool>& is_removed) {
+    auto merged = shared_ptr<IndexSegment>(new IndexSegment(older.ordinal_begin_, newer.ordinal_end_));
+    const auto append_term_postings = [&merged, &is_removed](const IndexSegment& segment, size_t term_index) {
+        Posting postings[POSTING_BLOCK_SIZE];
+        for (uint64_t block_index = segment.term_block_offsets_[term_index]; block_index < segment.term_block_offsets_[term_index + 1]; ++block_index) {
+            const size_t posting_count = segment.DecodeBlockOrdinals(static_cast<size_t>(block_index), postings);
+            for (size_t i = 0; i < posting_count; ++i) {
+                merged->AppendPosting(postings[i], is_removed);
+            }
+        }
+    };
+    merged->owned_data_.reserve(older.blocks_[older.block_count_].data_offset + newer.blocks_[newer.block_count_].data_offset);
+    size_t older_index = 0;
+    size_t newer_index = 0;
+    while (older_index < older.term_count_ || newer_index < newer.term_count_) {
+        const int older_term_id = older_index < older.term_count_ ? older.term_ids_[older_index] : numeric_limits<int>::max();
+        const int newer_term_id = newer_index < newer.term_count_ ? newer.term_ids_[newer_index] : numeric_limits<int>::max();
+        const int term_id = min(older_term_id, newer_term_id);
+        if (older_term_id == term_id) {
+            append_term_postings(older, older_index++);
+        }
+        if (newer_term_id == term_id) {
+            append_term_postings(newer, newer_index++);
+        }
+        merged->CloseTerm(term_id);
+    }
+    merged->owned_word_counts_.assign(older.word_counts_, older.word_counts_ + (older.ordinal_end_ - older.ordinal_begin_));
+    merged->owned_word_counts_.insert(merged->owned_word_counts_.end(), newer.word_counts_, newer.word_counts_ + (newer.ordinal_end_ - newer.ordinal_begin_));
+    merged->BindOwnedArrays();
+    return merged;
+}
+
+shared_ptr<const IndexSegment> IndexSegment::Renumber(const IndexSegment& segment, const vector<int>& new_ordinals, int ordinal_count) {
+    auto renumbered = shared_ptr<IndexSegment>(new IndexSegment(0, ordinal_count));
+    Posting postings[POSTING_BLOCK_SIZE];
+    for (size_t term_index = 0; term_index < segment.term_count_; ++term_index) {
+        for (uint64_t block_index = segment.term_block_offsets_[term_index]; block_index < segment.term_block_offsets_[term_index + 1]; ++block_index) {
+            const size_t posting_count = segment.DecodeBlockOrdinals(static_cast<size_t>(block_index), postings);
+            for (size_t i = 0; i < posting_count; ++i) {
+                const int new_ordinal = new_ordinals[static_cast<size_t>(postings[i].ordinal - segment.ordinal_begin_)];
+                if (new_ordinal >= 0) {
+                    renumbered->term_postings_.push_back({ new_ordinal, postings[i].term_count, 0.0 });
+                }
+            }
+        }
+        renumbered->CloseTerm(segment.term_ids_[term_index]);
+    }
+    renumbered->owned_word_counts_.resize(static_cast<size_t>(ordinal_count));
+    for (int ordinal = segment.ordinal_begin_; ordinal < segment.ordinal_end_; ++ordinal) {
+        const int new_ordinal = new_ordinals[static_cast<size_t>(ordinal - segment.ordinal_begin_)];
+        if (new_ordinal >= 0) {
+            renumbered->owned_word_counts_[static_cast<size_t>(new_ordinal)] = segment.word_counts_[ordinal - segment.ordinal_begin_];
+        }
+    }
+    renumbered->BindOwnedArrays();
+    return renumbered;
+}
+
+void IndexSegment::Save(ostream& output) const {
+    static_assert(sizeof(PostingBlock) == 16, "posting blocks are stored in index files in their in-memory layout");
+    WriteIndexValue(output, ordinal_begin_);
+    WriteIndexValue(output, ordinal_end_);
+    WriteIndexValue(output, static_cast<uint64_t>(term_count_));
+    WriteIndexValue(output, static_cast<uint64_t>(block_count_));
+    WriteIndexValue(output, static_cast<uint64_t>(posting_count_));
+    WriteIndexArray(output, term_ids_, term_count_);
+    WriteIndexArray(output, term_block_offsets_, term_count_ + 1);
+    WriteIndexArray(output, blocks_, block_count_ + 1);
+    WriteIndexArray(output, data_, static_cast<size_t>(blocks_[block_count_].data_offset));
+    WriteIndexArray(output, word_counts_, static_cast<size_t>(ordinal_end_ - ordinal_begin_));
+}
+
+shared_ptr<const IndexSegment> IndexSegment::Open(IndexFileReader& reader, shared_ptr<const void> mapping) {
+    const int ordinal_begin = reader.ReadValue<int>();
+    const int ordinal_end = reader.ReadValue<int>();
+    const uint64_t term_count = reader.ReadValue<uint64_t>();
+    const uint64_t block_count = reader.ReadValue<uint64_t>();
+    const uint64_t posting_count = reader.ReadValue<uint64_t>();
+    if (ordinal_begin < 0 || ordinal_end < ordinal_begin
+        || term_count > static_cast<uint64_t>(numeric_limits<int>::max()) || block_count >= numeric_limits<size_t>::max()) {
+        throw runtime_error("index file has a malformed segment"s);
+    }
+    auto segment = shared_ptr<IndexSegment>(new IndexSegment(ordinal_begin, ordinal_end));
+    segment->mapping_ = move(mapping);
+    segment->term_count_ = static_cast<size_t>(term_count);
+    segment->block_count_ = static_cast<size_t>(block_count);
+    segment->posting_count_ = static_cast<size_t>(posting_count);
+    segment->term_ids_ = reader.ReadArray<int>(segment->term_count_);
+    segment->term_block_offsets_ = reader.ReadArray<uint64_t>(segment->term_count_ + 1);
+    segment->blocks_ = reader.ReadArray<PostingBlock>(segment->block_count_ + 1);
+    const uint64_t data_size = segment->blocks_[segment->block_count_].data_offset;
+    if (data_size >= numeric_limits<size_t>::max()) {
+        throw runtime_error("index file has a malformed segment"s);
+    }
+    segment->data_ = reader.ReadArray<uint8_t>(static_cast<size_t>(data_size));
+    segment->word_counts_ = reader.ReadArray<int>(static_cast<size_t>(ordinal_end - ordinal_begin));
+    segment->Validate();
+    return segment;
+}
+
+int IndexSegment::GetOrdinalBegin() const {
+    return ordinal_begin_;
+}
+
+int IndexSegment::GetOrdinalEnd() const {
+    return ordinal_end_;
+}
+
+size_t IndexSegment::GetPostingCount() const {
+    return posting_count_;
+}
+
+IndexSegment::TermCursor::TermCursor(const IndexSegment& segment, int term_id)
+    : segment_(&segment)
+{
+    const int term_index = segment.FindTermIndex(term_id);
+    if (term_index >= 0) {
+        block_ = segment.blocks_ + segment.term_block_offsets_[term_index];
+        blocks_end_ = segment.blocks_ + segment.term_block_offsets_[term_index + 1];
+    }
+}
+
+bool IndexSegment::TermCursor::Contains(int ordinal) {
+    block_ = GallopLowerBound(block_, blocks_end_, ordinal,
+        [](const PostingBlock& block, int value) {
+            return block.last_ordinal < value;
+        });
+    if (block_ == blocks_end_ || block_->first_ordinal > ordinal) {
+        return false;
+    }
+    if (decoded_block_ != block_) {
+        posting_count_ = segment_->DecodeBlockOrdinals(static_cast<size_t>(block_ - segment_->blocks_), postings_);
+        posting_index_ = 0;
+        decoded_block_ = block_;
+    }
+    const Posting* position = GallopLowerBound(postings_ + posting_index_, postings_ + posting_count_, ordinal,
+        [](const Posting& posting, int value) {
+            return posting.ordinal < value;
+        });
+    posting_index_ = static_cast<size_t>(position - postings_);
+    return posting_index_ < posting_count_ && position->ordinal == ordinal;
+}
+
+void IndexSegment::BindOwnedArrays() {
+    owned_blocks_.push_back({ owned_data_.size(), 0, 0 });
+    term_postings_ = {};
+    term_ids_ = owned_term_ids_.data();
+    term_count_ = owned_term_ids_.size();
+    term_block_offsets_ = owned_term_block_offsets_.data();
+    blocks_ = owned_blocks_.data();
+    block_count_ = owned_blocks_.size() - 1;
+    data_ = owned_data_.data();
+    word_counts_ = owned_word_counts_.data();
+}
+
+int IndexSegment::FindTermIndex(int term_id) const {
+    const int* term_ids_end = term_ids_ + term_count_;
+    const int* position = lower_bound(term_ids_, term_ids_end, term_id);
+    if (position == term_ids_end || *position != term_id) {
+        return -1;
+    }
+    return static_cast<int>(position - term_ids_);
+}
+
+size_t IndexSegment::DecodeBlock(size_t block_index, Posting* postings) const {
+    const size_t posting_count = DecodeBlockOrdinals(block_index, postings);
+    for (size_t i = 0; i < posting_count; ++i) {
+        postings[i].term_frequency = postings[i].term_count / static_cast<double>(word_counts_[postings[i].ordinal - ordinal_begin_]);
+    }
+    return posting_count;
+}
+
+// Fills ordinals and term counts only. Stops at a posting whose ordinal does not
+// ascend within the block header's range or whose term count is not positive.
+size_t IndexSegment::DecodeBlockOrdinals(size_t block_index, Posting* postings) const {
+    const uint8_t* position = data_ + blocks_[block_index].data_offset;
+    const uint8_t* end = data_ + blocks_[block_index + 1].data_offset;
+    const uint64_t last_ordinal = static_cast<uint64_t>(blocks_[block_index].last_ordinal);
+    uint64_t ordinal = static_cast<uint64_t>(blocks_[block_index].first_ordinal);
+    size_t posting_count = 0;
+    while (position != end && posting_count < POSTING_BLOCK_SIZE) {
+        uint32_t delta = 0;
+        if (posting_count > 0 && ((position = ReadVarint(position, end, delta)) == nullptr || delta == 0)) {
+            break;
+        }
+        uint32_t term_count = 0;
+        if ((position = ReadVarint(position, end, term_count)) == nullptr
+            || term_count == 0 || term_count > static_cast<uint32_t>(numeric_limits<int>::max())) {
+            break;
+        }
+        ordinal += delta;
+        if (ordinal > last_ordinal) {
+            break;
+        }
+        postings[posting_count++] = { static_cast<int>(ordinal), static_cast<int>(term_count), 0.0 };
+    }
+    return posting_count;
+}
+
+void IndexSegment::AppendPosting(const Posting& posting, const vector<bool>& is_removed) {
+    if (!is_removed[static_cast<size_t>(posting.ordinal - ordinal_begin_)]) {
+        term_postings_.push_back(posting);
+    }
+}
+
+void IndexSegment::CloseTerm(int term_id) {
+    if (term_postings_.empty()) {
+        return;
+    }
+    for (size_t block_begin = 0; block_begin < term_postings_.size(); block_begin += POSTING_BLOCK_SIZE) {
+        const size_t block_end = min(block_begin + POSTING_BLOCK_SIZE, term_postings_.size());
+        owned_blocks_.push_back({ owned_data_.size(), term_postings_[block_begin].ordinal, term_postings_[block_end - 1].ordinal });
+        for (size_t i = block_begin; i < block_end; ++i) {
+            if (i > block_begin) {
+                AppendVarint(owned_data_, static_cast<uint32_t>(term_postings_[i].ordinal - term_postings_[i - 1].ordinal));
+            }
+            AppendVarint(owned_data_, static_cast<uint32_t>(term_postings_[i].term_count));
+        }
+    }
+    owned_term_ids_.push_back(term_id);
+    owned_term_block_offsets_.push_back(owned_blocks_.size());
+    posting_count_ += term_postings_.size();
+    term_postings_.clear();
+}
+
+// Checks the term and block headers that lookups rely on without decoding any block,
+// so opening costs O(blocks). Decoding stops at the first posting that contradicts
+// its block header, so a corrupted block cannot make queries read outside the mapping.
+void IndexSegment::Validate() const {
+    const auto check = [](bool condition) {
+        if (!condition) {
+            throw runtime_error("index file has a malformed segment"s);
+        }
+    };
+    check(term_block_offsets_[0] == 0 && term_block_offsets_[term_count_] == block_count_);
+    for (size_t term_index = 0; term_index < term_count_; ++term_index) {
+        check(term_block_offsets_[term_index] < term_block_offsets_[term_index + 1]);
+        check(term_index == 0 || term_ids_[term_index - 1] < term_ids_[term_index]);
+    }
+    for (size_t term_index = 0; term_index < term_count_; ++term_index) {
+        for (uint64_t block_index = term_block_offsets_[term_index]; block_index < term_block_offsets_[term_index + 1]; ++block_index) {
+            const PostingBlock& block = blocks_[block_index];
+            check(block.data_offset < blocks_[block_index + 1].data_offset);
+            check(block.first_ordinal >= ordinal_begin_ && block.first_ordinal <= block.last_ordinal && block.last_ordinal < ordinal_end_);
+            check(block_index == term_block_offsets_[term_index] || blocks_[block_index - 1].last_ordinal < block.first_ordinal);
+        }
+    }
+    check(block_count_ == 0 || blocks_[0].data_offset == 0);
+    check(posting_count_ <= blocks_[block_count_].data_offset);
+}
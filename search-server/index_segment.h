@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "index_file.h"
+#include "paginator.h"
+
+struct Posting {
+    int ordinal;
+    int term_count;
+    double term_frequency;
+};
+
+using PostingRange = IteratorRange<const Posting*>;
+
+// Lower bound for a value expected close to first: probes first + 1, 3, 7, ...
+// and binary-searches the last step, so moving d elements ahead costs O(log d).
+template <typename Iterator, typename Value, typename Less>
+Iterator GallopLowerBound(Iterator first, Iterator last, const Value& value, Less less) {
+    if (first == last || !less(*first, value)) {
+        return first;
+    }
+    Iterator low = first;
+    std::ptrdiff_t step = 1;
+    while (step < last - low && less(low[step], value)) {
+        low += step;
+        step *= 2;
+    }
+    return std::lower_bound(low + 1, step < last - low ? low + step + 1 : last, value, less);
+}
+
+const size_t POSTING_BLOCK_SIZE = 128;
+
+// Immutable postings of the documents with ordinals in [ordinal_begin, ordinal_end).
+// The postings of a term are sorted by ordinal and split into blocks of up to
+// POSTING_BLOCK_SIZE. A block stores each posting as a varint ordinal delta and a
+// varint term count; term frequencies are recomputed from the document word counts
+// kept by the segment, so decoded postings are exactly the ones that were added.
+// Block headers hold the first and last ordinal, so a lookup decodes one block only.
+// A segment opened from an index file reads these arrays in place from the mapping.
+class IndexSegment {
+public:
+    // word_counts[i] and is_removed[i] describe the document with ordinal
+    // ordinal_begin + i; postings of removed documents are dropped.
+    IndexSegment(int ordinal_begin, int ordinal_end, const std::unordered_map<int, std::vector<Posting>>& postings_by_term,
+        const std::vector<int>& word_counts, const std::vector<bool>& is_removed);
+
+    IndexSegment(const IndexSegment&) = delete;
+    IndexSegment& operator=(const IndexSegment&) = delete;
+
+    static std::shared_ptr<const IndexSegment> Merge(const IndexSegment& older, const IndexSegment& newer, const std::vector<bool>& is_removed);
+    // The postings of segment with every ordinal o replaced by new_ordinals[o - ordinal_begin],
+    // in a segment of [0, ordinal_count). Postings mapped to a negative ordinal are
+    // dropped; the mapping must be increasing over the others.
+    static std::shared_ptr<const IndexSegment> Renumber(const IndexSegment& segment, const std::vector<int>& new_ordinals, int ordinal_count);
+
+    void Save(std::ostream& output) const;
+    // mapping keeps the memory read by reader alive for as long as the segment.
+    static std::shared_ptr<const IndexSegment> Open(IndexFileReader& reader, std::shared_ptr<const void> mapping);
+
+    int GetOrdinalBegin() const;
+    int GetOrdinalEnd() const;
+    size_t GetPostingCount() const;
+
+    // Tells whether documents have a posting of one term. Ordinals must be asked in
+    // ascending order: the cursor gallops over block headers from where it stopped
+    // and decodes only the blocks that may hold an asked ordinal.
+    class TermCursor;
+
+    // Calls handle_posting for the postings of a term with ordinals in
+    // [ordinal_begin, ordinal_end), in ordinal order. The first block of the range is
+    // found by a binary search over block headers, so a narrow range decodes only
+    // the blocks it overlaps.
+    template <typename PostingHandler>
+    void ForEachPosting(int term_id, int ordinal_begin, int ordinal_end, PostingHandler handle_posting) const;
+
+private:
+    struct PostingBlock {
+        uint64_t data_offset;
+        int first_ordinal;
+        int last_ordinal;
+    };
+
+    int ordinal_begin_;
+    int ordinal_end_;
+    std::vector<int> owned_term_ids_;
+    std::vector<uint64_t> owned_term_block_offsets_ = { 0 };
+    std::vector<PostingBlock> owned_blocks_;
+    std::vector<uint8_t> owned_data_;
+    std::vector<int> owned_word_counts_;
+    std::vector<Posting> term_postings_;
+    std::shared_ptr<const void> mapping_;
+
+    const int* term_ids_ = nullptr;
+    size_t term_count_ = 0;
+    // Blocks of the term with index i are [term_block_offsets_[i], term_block_offsets_[i + 1]).
+    // The block array ends with a sentinel whose data_offset is the size of data_.
+    const uint64_t* term_block_offsets_ = nullptr;
+    const PostingBlock* blocks_ = nullptr;
+    size_t block_count_ = 0;
+    const uint8_t* data_ = nullptr;
+    const int* word_counts_ = nullptr;
+    size_t posting_count_ = 0;
+
+    IndexSegment(int ordinal_begin, int ordinal_end);
+
+    void BindOwnedArrays();
+    int FindTermIndex(int term_id) const;
+    size_t DecodeBlock(size_t block_index, Posting* postings) const;
+    size_t DecodeBlockOrdinals(size_t block_index, Posting* postings) const;
+    void AppendPosting(const Posting& posting, const std::vector<bool>& is_removed);
+    void CloseTerm(int term_id);
+    void Validate() const;
+};
+
+class IndexSegment::TermCursor {
+public:
+    TermCursor(const IndexSegment& segment, int term_id);
+
+    bool Contains(int ordinal);
+
+private:
+    const IndexSegment* segment_;
+    const PostingBlock* block_ = nullptr;
+    const PostingBlock* blocks_end_ = nullptr;
+    const PostingBlock* decoded_block_ = nullptr;
+    Posting postings_[POSTING_BLOCK_SIZE];
+    size_t posting_count_ = 0;
+    size_t posting_index_ = 0;
+};
+
+template <typename PostingHandler>
+void IndexSegment::ForEachPosting(int term_id, int ordinal_begin, int ordinal_end, PostingHandler handle_posting) const {
+    const int term_index = FindTermIndex(term_id);
+    if (term_index < 0) {
+        return;
+    }
+    const PostingBlock* term_blocks_end = blocks_ + term_block_offsets_[term_index + 1];
+    const PostingBlock* block = std::lower_bound(blocks_ + term_block_offsets_[term_index], term_blocks_end, ordinal_begin,
+        [](const PostingBlock& block, int value) {
+            return block.last_ordinal < value;
+        });
+    Posting postings[POSTING_BLOCK_SIZE];
+    for (; block != term_blocks_end && block->first_ordinal < ordinal_end; ++block) {
+        const size_t posting_count = DecodeBlock(static_cast<size_t>(block - blocks_), postings);
+        for (size_t i = 0; i < posting_count; ++i) {
+            if (postings[i].ordinal >= ordinal_begin && postings[i].ordinal < ordinal_end) {
+                handle_posting(postings[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <execution>
+#include <numeric>
+
+#include "process_queries.h"
+
+using namespace std;
+
+vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const vector<string>& queries) {
+    vector<vector<Document>> documents_lists(queries.size());
+    transform(execution::par, queries.begin(), queries.end(), documents_lists.begin(),
+        [&search_server](const string& query) {
+            return search_server.FindTopDocuments(query);
+        });
+    return documents_lists;
+}
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries) {
+    return JoinedDocuments(ProcessQueries(search_server, queries));
+}
+
+JoinedDocuments::JoinedDocuments(vector<vector<Document>> results)
+    : results_(move(results))
+{
+}
+
+JoinedDocuments::Iterator JoinedDocuments::begin() const {
+    return Iterator(results_, 0);
+}
+
+JoinedDocuments::Iterator JoinedDocuments::end() const {
+    return Iterator(results_, results_.size());
+}
+
+size_t JoinedDocuments::size() const {
+    return accumulate(results_.begin(), results_.end(), size_t{ 0 },
+        [](size_t count, const vector<Document>& documents) {
+            return count + documents.size();
+        });
+}
+
+bool JoinedDocuments::empty() const {
+    return begin() == end();
+}
+
+JoinedDocuments::Iterator::Iterator(const vector<vector<Document>>& results, size_t query_index)
+    : results_(&results)
+    , query_index_(query_index)
+{
+    SkipEmptyResults();
+}
+
+JoinedDocuments::Iterator::reference JoinedDocuments::Iterator::operator*() const {
+    return (*results_)[query_index_][document_index_];
+}
+
+JoinedDocuments::Iterator::pointer JoinedDocuments::Iterator::operator->() const {
+    return &**this;
+}
+
+JoinedDocuments::Iterator& JoinedDocuments::Iterator::operator++() {
+    ++document_index_;
+    if (document_index_ == (*results_)[query_index_].size()) {
+        ++query_index_;
+        document_index_ = 0;
+        SkipEmptyResults();
+    }
+    return *this;
+}
+
+JoinedDocuments::Iterator JoinedDocuments::Iterator::operator++(int) {
+    Iterator previous = *this;
+    ++*this;
+    return previous;
+}
+
+bool JoinedDocuments::Iterator::operator==(const Iterator& other) const {
+    return results_ == other.results_ && query_index_ == other.query_index_ && document_index_ == other.document_index_;
+}
+
+bool JoinedDocuments::Iterator::operator!=(const Iterator& other) const {
+    return !(*this == other);
+}
+
+void JoinedDocuments::Iterator::SkipEmptyResults() {
+    while (query_index_ < results_->size() && (*results_)[query_index_].empty()) {
+        ++query_index_;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+class JoinedDocuments {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator(const std::vector<std::vector<Document>>& results, size_t query_index);
+
+        reference operator*() const;
+        pointer operator->() const;
+        Iterator& operator++();
+        Iterator operator++(int);
+        bool operator==(const Iterator& other) const;
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        const std::vector<std::vector<Document>>* results_;
+        size_t query_index_;
+        size_t document_index_ = 0;
+
+        void SkipEmptyResults();
+    };
+
+    explicit JoinedDocuments(std::vector<std::vector<Document>> results);
+
+    Iterator begin() const;
+    Iterator end() const;
+    size_t size() const;
+    bool empty() const;
+
+private:
+    std::vector<std::vector<Document>> results_;
+};
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+#include "query_arena.h"
+
+using namespace std;
+
+namespace {
+
+const size_t INITIAL_QUERY_ARENA_SIZE = 64 * 1024;
+const size_t MAX_QUERY_ARENA_SIZE = 16 * 1024 * 1024;
+
+// Takes the blocks the monotonic buffer needs beyond the arena block from the global
+// heap and counts them, so the next arena block can hold them all.
+class OverflowResource : public pmr::memory_resource {
+public:
+    size_t TakeAllocatedSize() {
+        const size_t allocated_size = allocated_size_;
+        allocated_size_ = 0;
+        return allocated_size;
+    }
+
+private:
+    size_t allocated_size_ = 0;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        allocated_size_ += bytes;
+        return pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+class QueryArena {
+public:
+    pmr::memory_resource* Enter() {
+        if (depth_++ == 0) {
+            buffer_resource_.emplace(block_.get(), block_size_, &overflow_resource_);
+        }
+        return &*buffer_resource_;
+    }
+
+    void Leave() {
+        if (--depth_ > 0) {
+            return;
+        }
+        buffer_resource_.reset();
+        const size_t overflow_size = overflow_resource_.TakeAllocatedSize();
+        if (overflow_size > 0 && block_size_ < MAX_QUERY_ARENA_SIZE) {
+            block_size_ = min(block_size_ + overflow_size, MAX_QUERY_ARENA_SIZE);
+            block_ = make_unique<byte[]>(block_size_);
+        }
+    }
+
+private:
+    size_t block_size_ = INITIAL_QUERY_ARENA_SIZE;
+    unique_ptr<byte[]> block_ = make_unique<byte[]>(block_size_);
+    OverflowResource overflow_resource_;
+    optional<pmr::monotonic_buffer_resource> buffer_resource_;
+    int depth_ = 0;
+};
+
+thread_local QueryArena query_arena;
+
+}
+
+QueryArenaScope::QueryArenaScope()
+    : resource_(query_arena.Enter())
+{
+}
+
+QueryArenaScope::~QueryArenaScope() {
+    query_arena.Leave();
+}
+
+pmr::memory_resource* QueryArenaScope::GetResource() const {
+    return resource_;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <memory_resource>
+
+// Memory for the temporary data of a query on the calling thread. Every thread has
+// one arena: a monotonic buffer over a block that is reused by all its queries and
+// grows to the largest query seen, so once a thread has warmed up its queries do
+// not touch the global heap. The block grows to 16 MiB at most, so one huge query
+// does not pin its memory to the thread; larger queries take the rest from the heap
+// and return it when they end. The arena is reset when the outermost scope of the
+// thread ends; a scope opened inside another one, e.g. by a query that a parallel
+// algorithm runs while the thread waits, allocates after the outer one.
+// The resource is not synchronized and must only be used by the thread that opened
+// the scope.
+class QueryArenaScope {
+public:
+    QueryArenaScope();
+    QueryArenaScope(const QueryArenaScope&) = delete;
+    QueryArenaScope& operator=(const QueryArenaScope&) = delete;
+    ~QueryArenaScope();
+
+    std::pmr::memory_resource* GetResource() const;
+
+private:
+    std::pmr::memory_resource* resource_;
+};
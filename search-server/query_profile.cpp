@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "query_profile.h"
+
+using namespace std;
+
+namespace {
+
+const char* const QUERY_STAGE_NAMES[QUERY_STAGE_COUNT] = { "parse", "postings", "minus_words", "predicate", "select_top", "total" };
+const char* const QUERY_COUNTER_NAMES[QUERY_COUNTER_COUNT] = { "postings_scanned", "candidates", "predicate_rejections" };
+
+void MergeQueryProfile(QueryProfileSnapshot& profile, const QueryProfileSnapshot& other) {
+    for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+        profile.stage_nanoseconds[stage].Merge(other.stage_nanoseconds[stage]);
+    }
+    for (size_t counter = 0; counter < QUERY_COUNTER_COUNT; ++counter) {
+        profile.counters[counter].Merge(other.counters[counter]);
+    }
+}
+
+class ThreadQueryProfile;
+
+// Profiles of running threads, and the merged histograms of exited ones.
+struct QueryProfileRegistry {
+    mutex registry_mutex;
+    vector<const ThreadQueryProfile*> thread_profiles;
+    QueryProfileSnapshot exited_threads_profile;
+};
+
+QueryProfileRegistry& GetQueryProfileRegistry() {
+    static QueryProfileRegistry registry;
+    return registry;
+}
+
+// The histograms are only locked against snapshots, so a finished query takes an
+// uncontended lock. The current query is touched by its own thread only.
+class ThreadQueryProfile {
+public:
+    ThreadQueryProfile() {
+        QueryProfileRegistry& registry = GetQueryProfileRegistry();
+        lock_guard guard(registry.registry_mutex);
+        registry.thread_profiles.push_back(this);
+    }
+
+    ~ThreadQueryProfile() {
+        QueryProfileRegistry& registry = GetQueryProfileRegistry();
+        lock_guard guard(registry.registry_mutex);
+        MergeQueryProfile(registry.exited_threads_profile, *histograms_);
+        registry.thread_profiles.erase(find(registry.thread_profiles.begin(), registry.thread_profiles.end(), this));
+    }
+
+    void BeginQuery() {
+        if (query_depth_++ == 0) {
+            stage_nanoseconds_.fill(0);
+            counters_.fill(0);
+        }
+    }
+
+    void EndQuery(uint64_t total_nanoseconds) {
+        if (--query_depth_ > 0) {
+            return;
+        }
+        stage_nanoseconds_[static_cast<size_t>(QueryStage::TOTAL)] = total_nanoseconds;
+        lock_guard guard(histograms_mutex_);
+        for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+            histograms_->stage_nanoseconds[stage].Add(stage_nanoseconds_[stage]);
+        }
+        for (size_t counter = 0; counter < QUERY_COUNTER_COUNT; ++counter) {
+            histograms_->counters[counter].Add(counters_[counter]);
+        }
+    }
+
+    void AddStageTime(QueryStage stage, uint64_t nanoseconds) {
+        if (query_depth_ > 0) {
+            stage_nanoseconds_[static_cast<size_t>(stage)] += nanoseconds;
+        }
+    }
+
+    void Count(QueryCounter counter, uint64_t value) {
+        if (query_depth_ > 0) {
+            counters_[static_cast<size_t>(counter)] += value;
+        }
+    }
+
+    void AddTo(QueryProfileSnapshot& profile) const {
+        lock_guard guard(histograms_mutex_);
+        MergeQueryProfile(profile, *histograms_);
+    }
+
+private:
+    mutable mutex histograms_mutex_;
+    // Too large for thread-local storage of every thread.
+    unique_ptr<QueryProfileSnapshot> histograms_ = make_unique<QueryProfileSnapshot>();
+    int query_depth_ = 0;
+    array<uint64_t, QUERY_STAGE_COUNT> stage_nanoseconds_ = {};
+    array<uint64_t, QUERY_COUNTER_COUNT> counters_ = {};
+};
+
+ThreadQueryProfile& GetThreadQueryProfile() {
+    thread_local ThreadQueryProfile thread_profile;
+    return thread_profile;
+}
+
+uint64_t GetNanosecondsSince(chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+}
+
+void DumpQueryHistogram(ostream& output, const char* name, const char* unit, const QueryHistogram& histogram) {
+    output << name << ": count " << histogram.GetCount()
+        << ", mean " << (histogram.GetCount() == 0 ? 0 : histogram.GetSum() / histogram.GetCount()) << unit
+        << ", p50 " << histogram.GetPercentile(50.0) << unit
+        << ", p90 " << histogram.GetPercentile(90.0) << unit
+        << ", p99 " << histogram.GetPercentile(99.0) << unit
+        << ", p99.9 " << histogram.GetPercentile(99.9) << unit
+        << ", max " << histogram.GetMax() << unit << '\n';
+}
+
+}
+
+void QueryHistogram::Add(uint64_t value, uint64_t count) {
+    bucket_counts_[GetBucket(value)] += count;
+    count_ += count;
+    sum_ += value * count;
+    if (count > 0) {
+        max_ = max(max_, value);
+    }
+}
+
+void QueryHistogram::Merge(const QueryHistogram& other) {
+    for (size_t bucket = 0; bucket < QUERY_HISTOGRAM_BUCKET_COUNT; ++bucket) {
+        bucket_counts_[bucket] += other.bucket_counts_[bucket];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = max(max_, other.max_);
+}
+
+uint64_t QueryHistogram::GetCount() const {
+    return count_;
+}
+
+uint64_t QueryHistogram::GetSum() const {
+    return sum_;
+}
+
+uint64_t QueryHistogram::GetMax() const {
+    return max_;
+}
+
+uint64_t QueryHistogram::GetPercentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(percentile / 100.0 * static_cast<double>(count_))));
+    uint64_t seen_count = 0;
+    for (size_t bucket = 0; bucket < QUERY_HISTOGRAM_BUCKET_COUNT; ++bucket) {
+        seen_count += bucket_counts_[bucket];
+        if (seen_count >= rank) {
+            return min(GetBucketUpperBound(bucket), max_);
+        }
+    }
+    return max_;
+}
+
+size_t QueryHistogram::GetBucket(uint64_t value) {
+    const uint64_t sub_bucket_count = uint64_t{ 1 } << QUERY_HISTOGRAM_SUB_BUCKET_BITS;
+    if (value < sub_bucket_count) {
+        return static_cast<size_t>(value);
+    }
+    int highest_bit = 0;
+    while (highest_bit < 63 && value >> (highest_bit + 1) != 0) {
+        ++highest_bit;
+    }
+    const int shift = highest_bit - QUERY_HISTOGRAM_SUB_BUCKET_BITS;
+    return static_cast<size_t>((shift + 1) * sub_bucket_count + ((value >> shift) - sub_bucket_count));
+}
+
+uint64_t QueryHistogram::GetBucketUpperBound(size_t bucket) {
+    const size_t sub_bucket_count = size_t{ 1 } << QUERY_HISTOGRAM_SUB_BUCKET_BITS;
+    if (bucket < sub_bucket_count) {
+        return bucket;
+    }
+    const size_t shift = bucket / sub_bucket_count - 1;
+    const uint64_t next_bucket_begin_mantissa = sub_bucket_count + bucket % sub_bucket_count + 1;
+    // Wraps to the largest value for the last bucket.
+    return (next_bucket_begin_mantissa << shift) - 1;
+}
+
+uint64_t QueryHistogram::GetBucketCount(size_t bucket) const {
+    return bucket_counts_[bucket];
+}
+
+QueryProfileSnapshot GetQueryProfileSnapshot() {
+    QueryProfileSnapshot profile;
+    QueryProfileRegistry& registry = GetQueryProfileRegistry();
+    lock_guard guard(registry.registry_mutex);
+    MergeQueryProfile(profile, registry.exited_threads_profile);
+    for (const ThreadQueryProfile* thread_profile : registry.thread_profiles) {
+        thread_profile->AddTo(profile);
+    }
+    return profile;
+}
+
+void DumpQueryProfile(ostream& output) {
+    const QueryProfileSnapshot profile = GetQueryProfileSnapshot();
+    for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+        DumpQueryHistogram(output, QUERY_STAGE_NAMES[stage], " ns", profile.stage_nanoseconds[stage]);
+    }
+    for (size_t counter = 0; counter < QUERY_COUNTER_COUNT; ++counter) {
+        DumpQueryHistogram(output, QUERY_COUNTER_NAMES[counter], "", profile.counters[counter]);
+    }
+}
+
+QueryProfileScope::QueryProfileScope()
+    : start_(chrono::steady_clock::now())
+{
+    GetThreadQueryProfile().BeginQuery();
+}
+
+QueryProfileScope::~QueryProfileScope() {
+    GetThreadQueryProfile().EndQuery(GetNanosecondsSince(start_));
+}
+
+QueryStageTimer::QueryStageTimer(QueryStage stage)
+    : stage_(stage)
+    , start_(chrono::steady_clock::now())
+{
+}
+
+QueryStageTimer::~QueryStageTimer() {
+    GetThreadQueryProfile().AddStageTime(stage_, GetNanosecondsSince(start_));
+}
+
+void CountQueryEvent(QueryCounter counter, uint64_t value) {
+    GetThreadQueryProfile().Count(counter, value);
+}
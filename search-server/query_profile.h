@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Stages of FindTopDocuments. TOTAL is the whole query; the other stages do not
+// cover everything inside it.
+enum class QueryStage {
+    PARSE,
+    POSTINGS,
+    MINUS_WORDS,
+    PREDICATE,
+    SELECT_TOP,
+    TOTAL
+};
+
+const size_t QUERY_STAGE_COUNT = 6;
+
+enum class QueryCounter {
+    POSTINGS_SCANNED,
+    CANDIDATES,
+    PREDICATE_REJECTIONS
+};
+
+const size_t QUERY_COUNTER_COUNT = 3;
+
+const int QUERY_HISTOGRAM_SUB_BUCKET_BITS = 4;
+const size_t QUERY_HISTOGRAM_BUCKET_COUNT = size_t{ 64 - QUERY_HISTOGRAM_SUB_BUCKET_BITS + 1 } << QUERY_HISTOGRAM_SUB_BUCKET_BITS;
+
+// Distribution of values in HDR-style log-linear buckets: values below 16 have a
+// bucket each, and every power-of-two range above is split into 16 buckets, so a
+// percentile is off by less than 1/16 of the value.
+class QueryHistogram {
+public:
+    void Add(uint64_t value, uint64_t count = 1);
+    void Merge(const QueryHistogram& other);
+
+    uint64_t GetCount() const;
+    uint64_t GetSum() const;
+    uint64_t GetMax() const;
+    // The upper bound of the bucket holding the value at percentile, in [0, 100].
+    uint64_t GetPercentile(double percentile) const;
+
+    static size_t GetBucket(uint64_t value);
+    static uint64_t GetBucketUpperBound(size_t bucket);
+    uint64_t GetBucketCount(size_t bucket) const;
+
+private:
+    std::array<uint64_t, QUERY_HISTOGRAM_BUCKET_COUNT> bucket_counts_ = {};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+// Stage times are in nanoseconds; counters are per query.
+struct QueryProfileSnapshot {
+    std::array<QueryHistogram, QUERY_STAGE_COUNT> stage_nanoseconds;
+    std::array<QueryHistogram, QUERY_COUNTER_COUNT> counters;
+};
+
+// Merges the histograms of all threads, including threads that have exited. Threads
+// keep recording while the snapshot is taken.
+QueryProfileSnapshot GetQueryProfileSnapshot();
+// Prints count, mean, p50, p90, p99, p99.9 and max of every stage and counter.
+void DumpQueryProfile(std::ostream& output);
+
+// A query recorded on the calling thread. Stage times and counters are summed over
+// the query and added to the thread's histograms when its outermost scope ends; a
+// query run inside another one, e.g. by a predicate, is a part of the outer one.
+class QueryProfileScope {
+public:
+    QueryProfileScope();
+    QueryProfileScope(const QueryProfileScope&) = delete;
+    QueryProfileScope& operator=(const QueryProfileScope&) = delete;
+    ~QueryProfileScope();
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Adds the time until the end of the scope to a stage of the current query.
+class QueryStageTimer {
+public:
+    explicit QueryStageTimer(QueryStage stage);
+    QueryStageTimer(const QueryStageTimer&) = delete;
+    QueryStageTimer& operator=(const QueryStageTimer&) = delete;
+    ~QueryStageTimer();
+
+private:
+    QueryStage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Adds to a counter of the current query. Outside a query it does nothing.
+void CountQueryEvent(QueryCounter counter, uint64_t value);
+
+// The search server is instrumented through these macros, which expand to nothing
+// unless SEARCH_SERVER_PROFILE is defined. Stage timers in the per-candidate loop
+// cost two clock reads per candidate in a profiling build.
+#ifdef SEARCH_SERVER_PROFILE
+#define SEARCH_SERVER_PROFILE_CONCAT_IMPL(a, b) a##b
+#define SEARCH_SERVER_PROFILE_CONCAT(a, b) SEARCH_SERVER_PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_QUERY() QueryProfileScope SEARCH_SERVER_PROFILE_CONCAT(query_profile_scope_, __LINE__)
+#define PROFILE_QUERY_STAGE(stage) QueryStageTimer SEARCH_SERVER_PROFILE_CONCAT(query_stage_timer_, __LINE__)(stage)
+#define PROFILE_QUERY_COUNT(counter, value) CountQueryEvent(counter, value)
+#else
+#define PROFILE_QUERY()
+#define PROFILE_QUERY_STAGE(stage)
+#define PROFILE_QUERY_COUNT(counter, value)
+#endif
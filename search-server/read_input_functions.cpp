@@ -1,8 +1,200 @@
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <deque>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <string_view>
 #include "read_input_functions.h"
 
 using namespace std;
 
+namespace {
+
+// Parsed records of one block of the input. Texts of the documents point into data.
+struct DocumentBlock {
+    vector<char> data;
+    vector<NewDocument> documents;
+    vector<size_t> line_numbers;
+    vector<RejectedDocument> malformed_records;
+};
+
+// Hands blocks from the reader thread to the indexing thread. Push waits while
+// DOCUMENT_LOADER_QUEUE_CAPACITY blocks are queued, so the reader stays a few
+// blocks ahead of indexing without reading the whole input into memory.
+class DocumentBlockQueue {
+public:
+    // Returns false once the indexing thread has stopped taking blocks.
+    bool Push(DocumentBlock block) {
+        unique_lock lock(mutex_);
+        not_full_.wait(lock, [this]() {
+            return blocks_.size() < DOCUMENT_LOADER_QUEUE_CAPACITY || is_stopped_;
+            });
+        if (is_stopped_) {
+            return false;
+        }
+        blocks_.push_back(move(block));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Returns nullopt when the reader has finished and every block has been taken.
+    optional<DocumentBlock> Pop() {
+        unique_lock lock(mutex_);
+        not_empty_.wait(lock, [this]() {
+            return !blocks_.empty() || is_finished_;
+            });
+        if (blocks_.empty()) {
+            return nullopt;
+        }
+        DocumentBlock block = move(blocks_.front());
+        blocks_.pop_front();
+        not_full_.notify_one();
+        return block;
+    }
+
+    void Finish() {
+        lock_guard guard(mutex_);
+        is_finished_ = true;
+        not_empty_.notify_all();
+    }
+
+    void Stop() {
+        lock_guard guard(mutex_);
+        is_stopped_ = true;
+        not_full_.notify_all();
+    }
+
+private:
+    mutex mutex_;
+    condition_variable not_full_;
+    condition_variable not_empty_;
+    deque<DocumentBlock> blocks_;
+    bool is_finished_ = false;
+    bool is_stopped_ = false;
+};
+
+bool ParseInt(string_view text, int& value) {
+    const char* end = text.data() + text.size();
+    const auto [parsed_end, error] = from_chars(text.data(), end, value);
+    return error == errc() && parsed_end == end;
+}
+
+optional<DocumentStatus> ParseDocumentStatus(string_view text) {
+    if (text == "ACTUAL"sv) {
+        return DocumentStatus::ACTUAL;
+    }
+    if (text == "IRRELEVANT"sv) {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (text == "BANNED"sv) {
+        return DocumentStatus::BANNED;
+    }
+    if (text == "REMOVED"sv) {
+        return DocumentStatus::REMOVED;
+    }
+    return nullopt;
+}
+
+// Takes the text up to the next tab off the front of line; nullopt if there is no tab.
+optional<string_view> TakeField(string_view& line) {
+    const size_t tab = line.find('\t');
+    if (tab == string_view::npos) {
+        return nullopt;
+    }
+    const string_view field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+    return field;
+}
+
+bool ParseRecord(string_view line, NewDocument& document) {
+    const optional<string_view> id = TakeField(line);
+    const optional<string_view> status = TakeField(line);
+    const optional<string_view> ratings_field = TakeField(line);
+    if (!id || !ParseInt(*id, document.id)) {
+        document.id = 0;
+        return false;
+    }
+    const optional<DocumentStatus> parsed_status = status ? ParseDocumentStatus(*status) : nullopt;
+    if (!parsed_status || !ratings_field) {
+        return false;
+    }
+    string_view ratings = *ratings_field;
+    document.status = *parsed_status;
+    while (!ratings.empty()) {
+        const size_t space = ratings.find(' ');
+        const string_view rating = ratings.substr(0, space);
+        ratings.remove_prefix(space == string_view::npos ? ratings.size() : space + 1);
+        if (!rating.empty() && !ParseInt(rating, document.ratings.emplace_back())) {
+            return false;
+        }
+    }
+    document.text = line;
+    return true;
+}
+
+void ParseDocumentBlock(DocumentBlock& block, size_t& line_number) {
+    string_view text(block.data.data(), block.data.size());
+    while (!text.empty()) {
+        const size_t newline = text.find('\n');
+        string_view line = text.substr(0, newline);
+        text.remove_prefix(newline == string_view::npos ? text.size() : newline + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            NewDocument document;
+            if (ParseRecord(line, document)) {
+                block.documents.push_back(move(document));
+                block.line_numbers.push_back(line_number);
+            }
+            else {
+                block.malformed_records.push_back({ line_number, document.id, "malformed record"s });
+            }
+        }
+        ++line_number;
+    }
+}
+
+// A block ends at its last newline; the incomplete line after it starts the next
+// block, which is made larger if that line does not fit.
+void ReadDocumentBlocks(istream& input, DocumentBlockQueue& queue) {
+    vector<char> incomplete_line;
+    size_t line_number = 0;
+    while (true) {
+        DocumentBlock block;
+        block.data.resize(max(DOCUMENT_LOADER_BLOCK_SIZE, 2 * incomplete_line.size()));
+        copy(incomplete_line.begin(), incomplete_line.end(), block.data.begin());
+        input.read(block.data.data() + incomplete_line.size(), static_cast<streamsize>(block.data.size() - incomplete_line.size()));
+        if (input.bad()) {
+            throw ios_base::failure("cannot read documents"s);
+        }
+        const size_t size = incomplete_line.size() + static_cast<size_t>(input.gcount());
+        const bool is_last_block = !input;
+        size_t block_size = size;
+        if (!is_last_block) {
+            const auto last_newline = find(make_reverse_iterator(block.data.begin() + size), block.data.rend(), '\n');
+            block_size = static_cast<size_t>(block.data.rend() - last_newline);
+        }
+        incomplete_line.assign(block.data.begin() + block_size, block.data.begin() + size);
+        if (block_size == 0) {
+            if (is_last_block) {
+                return;
+            }
+            continue;
+        }
+        block.data.resize(block_size);
+        ParseDocumentBlock(block, line_number);
+        if (!queue.Push(move(block)) || is_last_block) {
+            return;
+        }
+    }
+}
+
+}
+
 string ReadLine() {
     string s;
     getline(cin, s);
@@ -14,4 +206,38 @@ int ReadLineWithNumber() {
     cin >> result;
     ReadLine();
     return result;
-}
\ No newline at end of file
+}
+
+vector<RejectedDocument> LoadDocuments(istream& input, SearchServer& search_server) {
+    DocumentBlockQueue queue;
+    future<void> reader = async(launch::async, [&input, &queue]() {
+        try {
+            ReadDocumentBlocks(input, queue);
+        }
+        catch (...) {
+            queue.Finish();
+            throw;
+        }
+        queue.Finish();
+        });
+    vector<RejectedDocument> rejected_documents;
+    try {
+        while (optional<DocumentBlock> block = queue.Pop()) {
+            rejected_documents.insert(rejected_documents.end(), block->malformed_records.begin(), block->malformed_records.end());
+            for (RejectedDocument& rejected_document : search_server.AddDocuments(block->documents)) {
+                rejected_document.position = block->line_numbers[rejected_document.position];
+                rejected_documents.push_back(move(rejected_document));
+            }
+        }
+    }
+    catch (...) {
+        queue.Stop();
+        reader.wait();
+        throw;
+    }
+    reader.get();
+    sort(rejected_documents.begin(), rejected_documents.end(), [](const RejectedDocument& lhs, const RejectedDocument& rhs) {
+        return lhs.position < rhs.position;
+        });
+    return rejected_documents;
+}
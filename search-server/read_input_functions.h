@@ -1,6 +1,24 @@
 #pragma once
 
+#include <istream>
 #include <string>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+const size_t DOCUMENT_LOADER_BLOCK_SIZE = 4 * 1024 * 1024;
+const size_t DOCUMENT_LOADER_QUEUE_CAPACITY = 4;
 
 std::string ReadLine();
 int ReadLineWithNumber();
+
+// Adds the documents of a dump with one record per line:
+//     id <TAB> status <TAB> space-separated ratings <TAB> text
+// where status is ACTUAL, IRRELEVANT, BANNED or REMOVED. A reader thread reads the
+// input in blocks of DOCUMENT_LOADER_BLOCK_SIZE and parses every block in place,
+// while the calling thread adds the previous blocks with AddDocuments. Empty lines
+// are skipped. Malformed records and documents AddDocuments rejects are reported
+// with position set to the zero-based line number. If reading the input fails, the
+// documents read before the failure are added and ios_base::failure is thrown.
+std::vector<RejectedDocument> LoadDocuments(std::istream& input, SearchServer& search_server);
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <atomic>
+
+#include "relevance_accumulator.h"
+
+using namespace std;
+
+namespace {
+
+// Zero everywhere but at the ordinals of the accumulator using it. It grows to the
+// largest range scored densely on the thread and is never shrunk.
+struct DenseRelevanceArray {
+    vector<double> relevances;
+    vector<uint8_t> is_touched;
+    bool is_in_use = false;
+};
+
+thread_local DenseRelevanceArray dense_relevance_array;
+atomic<uint64_t> dense_accumulator_count{ 0 };
+
+}
+
+RelevanceAccumulator::RelevanceAccumulator(int ordinal_begin, int ordinal_end, size_t expected_candidate_count, pmr::memory_resource* resource)
+    : ordinal_begin_(ordinal_begin)
+    , touched_ordinals_(resource)
+    , slots_(resource)
+{
+    const size_t ordinal_count = static_cast<size_t>(ordinal_end - ordinal_begin);
+    if (expected_candidate_count * DENSE_ACCUMULATOR_RATIO >= ordinal_count && ordinal_count <= MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT
+        && !dense_relevance_array.is_in_use) {
+        is_dense_ = true;
+        dense_relevance_array.is_in_use = true;
+        dense_accumulator_count.fetch_add(1, memory_order_relaxed);
+        if (dense_relevance_array.relevances.size() < ordinal_count) {
+            dense_relevance_array.relevances.resize(ordinal_count, 0.0);
+            dense_relevance_array.is_touched.resize(ordinal_count, 0);
+        }
+        dense_relevances_ = dense_relevance_array.relevances.data();
+        is_touched_ = dense_relevance_array.is_touched.data();
+        touched_ordinals_.reserve(min(expected_candidate_count, ordinal_count));
+        return;
+    }
+    size_t capacity = MIN_SPARSE_ACCUMULATOR_CAPACITY;
+    hash_shift_ = 64 - 4;
+    while (capacity < 2 * expected_candidate_count) {
+        capacity *= 2;
+        --hash_shift_;
+    }
+    slots_.assign(capacity, { EMPTY_ORDINAL, 0.0 });
+}
+
+RelevanceAccumulator::~RelevanceAccumulator() {
+    if (!is_dense_) {
+        return;
+    }
+    for (const int ordinal : touched_ordinals_) {
+        const size_t index = static_cast<size_t>(ordinal - ordinal_begin_);
+        dense_relevances_[index] = 0.0;
+        is_touched_[index] = 0;
+    }
+    dense_relevance_array.is_in_use = false;
+}
+
+bool RelevanceAccumulator::IsDense() const {
+    return is_dense_;
+}
+
+size_t RelevanceAccumulator::GetCandidateCount() const {
+    return is_dense_ ? touched_ordinals_.size() : slot_count_;
+}
+
+uint64_t RelevanceAccumulator::GetDenseAccumulatorCount() {
+    return dense_accumulator_count.load(memory_order_relaxed);
+}
+
+pmr::vector<pair<int, double>> RelevanceAccumulator::GetSortedCandidates() const {
+    pmr::vector<pair<int, double>> candidates(slots_.get_allocator().resource());
+    candidates.reserve(GetCandidateCount());
+    if (is_dense_) {
+        for (const int ordinal : touched_ordinals_) {
+            candidates.emplace_back(ordinal, dense_relevances_[ordinal - ordinal_begin_]);
+        }
+    }
+    else {
+        for (const Slot& slot : slots_) {
+            if (slot.ordinal != EMPTY_ORDINAL) {
+                candidates.emplace_back(slot.ordinal, slot.relevance);
+            }
+        }
+    }
+    sort(candidates.begin(), candidates.end(), [](const pair<int, double>& lhs, const pair<int, double>& rhs) {
+        return lhs.first < rhs.first;
+        });
+    return candidates;
+}
+
+void RelevanceAccumulator::GrowSlots() {
+    pmr::vector<Slot> old_slots(slots_.size() * 2, { EMPTY_ORDINAL, 0.0 }, slots_.get_allocator());
+    old_slots.swap(slots_);
+    --hash_shift_;
+    for (const Slot& slot : old_slots) {
+        if (slot.ordinal != EMPTY_ORDINAL) {
+            slots_[FindSlot(slot.ordinal)] = slot;
+        }
+    }
+}
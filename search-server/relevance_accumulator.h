@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+// A query is scored with a dense array once it may touch at least
+// 1 / DENSE_ACCUMULATOR_RATIO of the ordinals it scores, and the ordinals are no more
+// than MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT.
+const size_t DENSE_ACCUMULATOR_RATIO = 8;
+const size_t MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT = size_t{ 1 } << 21;
+const size_t MIN_SPARSE_ACCUMULATOR_CAPACITY = 16;
+
+// Sums the relevance of candidate documents by ordinal. Broad queries add into a
+// dense array indexed by ordinal and remember the touched ordinals in a list;
+// selective ones use an open-addressing hash table with linear probing, so neither
+// pays for a tree node per candidate. The dense array belongs to the thread and
+// outlives the query: only its touched entries are cleared afterwards, so a query
+// costs nothing per untouched ordinal, and the size limit bounds what a thread
+// keeps. One accumulator of a thread at a time uses the array; any other one uses
+// the hash table. Ordinals must be in [ordinal_begin, ordinal_end).
+class RelevanceAccumulator {
+public:
+    // expected_candidate_count is an estimate; the hash table grows past it if needed.
+    RelevanceAccumulator(int ordinal_begin, int ordinal_end, size_t expected_candidate_count, std::pmr::memory_resource* resource);
+    RelevanceAccumulator(const RelevanceAccumulator&) = delete;
+    RelevanceAccumulator& operator=(const RelevanceAccumulator&) = delete;
+    ~RelevanceAccumulator();
+
+    void Add(int ordinal, double relevance);
+
+    bool IsDense() const;
+    size_t GetCandidateCount() const;
+    // How many accumulators of all threads have used a dense array so far, so tests
+    // and benchmarks can tell which path the queries take.
+    static uint64_t GetDenseAccumulatorCount();
+    // Candidates with their relevance in ascending ordinal order.
+    std::pmr::vector<std::pair<int, double>> GetSortedCandidates() const;
+
+private:
+    static constexpr int EMPTY_ORDINAL = -1;
+
+    struct Slot {
+        int ordinal;
+        double relevance;
+    };
+
+    int ordinal_begin_;
+    bool is_dense_ = false;
+    // The thread's dense array, indexed by ordinal - ordinal_begin_.
+    double* dense_relevances_ = nullptr;
+    uint8_t* is_touched_ = nullptr;
+    std::pmr::vector<int> touched_ordinals_;
+    std::pmr::vector<Slot> slots_;
+    // The hash of an ordinal is the top bits of its product with 2^64 / phi.
+    int hash_shift_ = 0;
+    size_t slot_count_ = 0;
+
+    size_t FindSlot(int ordinal) const;
+    void GrowSlots();
+};
+
+inline void RelevanceAccumulator::Add(int ordinal, double relevance) {
+    if (is_dense_) {
+        const size_t index = static_cast<size_t>(ordinal - ordinal_begin_);
+        if (!is_touched_[index]) {
+            is_touched_[index] = 1;
+            touched_ordinals_.push_back(ordinal);
+        }
+        dense_relevances_[index] += relevance;
+        return;
+    }
+    size_t slot_index = FindSlot(ordinal);
+    if (slots_[slot_index].ordinal == EMPTY_ORDINAL) {
+        if (2 * (slot_count_ + 1) > slots_.size()) {
+            GrowSlots();
+            slot_index = FindSlot(ordinal);
+        }
+        slots_[slot_index].ordinal = ordinal;
+        ++slot_count_;
+    }
+    slots_[slot_index].relevance += relevance;
+}
+
+inline size_t RelevanceAccumulator::FindSlot(int ordinal) const {
+    const size_t mask = slots_.size() - 1;
+    size_t slot_index = static_cast<size_t>((static_cast<uint64_t>(static_cast<uint32_t>(ordinal)) * 0x9E3779B97F4A7C15ull) >> hash_shift_);
+    while (slots_[slot_index].ordinal != ordinal && slots_[slot_index].ordinal != EMPTY_ORDINAL) {
+        slot_index = (slot_index + 1) & mask;
+    }
+    return slot_index;
+}
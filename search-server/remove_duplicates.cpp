@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <iterator>
+
+#include "remove_duplicates.h"
+
+using namespace std;
+
+namespace {
+
+struct DocumentWordsHash {
+    size_t hash;
+    int document_id;
+};
+
+}
+
+// Documents are hashed by the term ids of their forward indexes and sorted by hash,
+// so only documents with equal hashes are compared, term id by term id. Ids come in
+// ascending order and the sort is stable, so among equal documents the first one of
+// a hash group has the smallest id and is kept.
+vector<int> RemoveDuplicates(SearchServer& search_server) {
+    vector<DocumentWordsHash> document_hashes;
+    document_hashes.reserve(static_cast<size_t>(search_server.GetDocumentCount()));
+    for (const int document_id : search_server) {
+        document_hashes.push_back({ search_server.GetWordFrequencies(document_id).HashWords(), document_id });
+    }
+    stable_sort(document_hashes.begin(), document_hashes.end(), [](const DocumentWordsHash& lhs, const DocumentWordsHash& rhs) {
+        return lhs.hash < rhs.hash;
+        });
+
+    vector<int> duplicates;
+    for (auto group_begin = document_hashes.begin(); group_begin != document_hashes.end();) {
+        const auto group_end = find_if(group_begin, document_hashes.end(), [group_begin](const DocumentWordsHash& document_hash) {
+            return document_hash.hash != group_begin->hash;
+            });
+        for (auto document_it = next(group_begin); document_it != group_end; ++document_it) {
+            const SearchServer::WordFrequencies words = search_server.GetWordFrequencies(document_it->document_id);
+            // A document equal to an earlier duplicate also equals that duplicate's original.
+            const bool is_duplicate = any_of(group_begin, document_it, [&search_server, &words](const DocumentWordsHash& earlier) {
+                return search_server.GetWordFrequencies(earlier.document_id).HasSameWords(words);
+                });
+            if (is_duplicate) {
+                duplicates.push_back(document_it->document_id);
+            }
+        }
+        group_begin = group_end;
+    }
+    sort(duplicates.begin(), duplicates.end());
+    for (const int document_id : duplicates) {
+        search_server.RemoveDocument(document_id);
+    }
+    return duplicates;
+}
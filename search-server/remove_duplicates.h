@@ -0,0 +1,9 @@
+#pragma once
+
+#include <vector>
+
+#include "search_server.h"
+
+// Removes documents whose set of words equals the set of words of a document
+// with a smaller id and returns the ids of the removed documents in ascending order.
+std::vector<int> RemoveDuplicates(SearchServer& search_server);
@@ -1,27 +1,95 @@
+#include "query_arena.h"
 #include "request_queue.h"
 
 using namespace std;
 
-RequestQueue::RequestQueue(const SearchServer& search_server)
-    :search_server_(search_server)
+RequestQueue::RequestQueue(const SearchServer& search_server, size_t cache_capacity)
+    :search_server_(&search_server)
+    , cache_capacity_(cache_capacity)
+{
+}
+
+RequestQueue::RequestQueue(const VersionedSearchServer& search_server, size_t cache_capacity)
+    :versioned_search_server_(&search_server)
+    , cache_capacity_(cache_capacity)
 {
 }
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
-    vector<Document> documents_found = search_server_.FindTopDocuments(raw_query, status);
+    vector<Document> documents_found = FindTopDocumentsCached(raw_query, status);
     CreateRequestsDeque(documents_found);
     return documents_found;
 }
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query) {
-    vector<Document> documents_found = search_server_.FindTopDocuments(raw_query);
-    CreateRequestsDeque(documents_found);
-    return documents_found;
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
+}
+
+shared_ptr<const SearchServer> RequestQueue::GetSearchServer() const {
+    if (versioned_search_server_ != nullptr) {
+        return versioned_search_server_->GetSnapshot();
+    }
+    return shared_ptr<const SearchServer>(shared_ptr<const SearchServer>(), search_server_);
 }
 
 int RequestQueue::GetNoResultRequests() const {
     return no_result_requests_;
 }
 
+size_t RequestQueue::GetCacheHits() const {
+    return cache_hits_;
+}
+
+size_t RequestQueue::GetCacheMisses() const {
+    return cache_misses_;
+}
+
+// The snapshot is taken once, so a cached result always belongs to the epoch it
+// was checked against. The query is parsed once: a miss ranks the parsed query
+// the key was made from.
+vector<Document> RequestQueue::FindTopDocumentsCached(const string& raw_query, DocumentStatus status) {
+    const shared_ptr<const SearchServer> search_server = GetSearchServer();
+    if (cache_capacity_ == 0) {
+        return search_server->FindTopDocuments(raw_query, status);
+    }
+    if (search_server->GetEpoch() != cache_epoch_) {
+        cached_result_positions_.clear();
+        cached_results_.clear();
+        cache_epoch_ = search_server->GetEpoch();
+    }
+    QueryArenaScope query_arena;
+    const SearchServer::QueryPlusAndMinusWords query_plus_and_minus_words = search_server->FindQueryPlusAndMinusWords(raw_query, query_arena.GetResource());
+    string query_key = MakeQueryKey(query_plus_and_minus_words, status);
+    const auto position_it = cached_result_positions_.find(query_key);
+    if (position_it != cached_result_positions_.end()) {
+        ++cache_hits_;
+        cached_results_.splice(cached_results_.begin(), cached_results_, position_it->second);
+        return position_it->second->documents;
+    }
+    ++cache_misses_;
+    vector<Document> documents_found = search_server->FindTopDocuments(query_plus_and_minus_words, status);
+    if (cached_results_.size() == cache_capacity_) {
+        cached_result_positions_.erase(cached_results_.back().query_key);
+        cached_results_.pop_back();
+    }
+    cached_results_.push_front({ move(query_key), documents_found });
+    cached_result_positions_.emplace(cached_results_.front().query_key, cached_results_.begin());
+    return documents_found;
+}
+
+// Words cannot contain control characters, so they separate the parts of the key.
+string RequestQueue::MakeQueryKey(const SearchServer::QueryPlusAndMinusWords& query_plus_and_minus_words, DocumentStatus status) {
+    string query_key(1, static_cast<char>('0' + static_cast<int>(status)));
+    for (const string_view word : query_plus_and_minus_words.plus_words) {
+        query_key += '\x01';
+        query_key += word;
+    }
+    for (const string_view word : query_plus_and_minus_words.minus_words) {
+        query_key += '\x02';
+        query_key += word;
+    }
+    return query_key;
+}
+
 void RequestQueue::CreateRequestsDeque(vector<Document> documents_found) {
     if (requests_.size() == min_in_day_) {
         if (requests_.front().no_documents_found == true) {
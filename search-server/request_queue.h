@@ -1,22 +1,36 @@
 #pragma once
 
+#include <cstdint>
 #include <deque>
+#include <list>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "document.h"
 #include "search_server.h"
+#include "versioned_search_server.h"
 
+const size_t QUERY_CACHE_CAPACITY = 1024;
 
+// Results of status queries are kept in an LRU cache keyed on the parsed query, so
+// the same plus and minus words in any order and with repeats share an entry. The
+// cache is dropped whenever the server's epoch changes. Queries with a custom
+// predicate are not cached.
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server);
-    
+    explicit RequestQueue(const SearchServer& search_server, size_t cache_capacity = QUERY_CACHE_CAPACITY);
+    explicit RequestQueue(const VersionedSearchServer& search_server, size_t cache_capacity = QUERY_CACHE_CAPACITY);
+
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
     int GetNoResultRequests() const;
+    size_t GetCacheHits() const;
+    size_t GetCacheMisses() const;
 
 private:
     struct QueryResult {
@@ -25,14 +39,30 @@ private:
     std::deque<QueryResult> requests_;
     const static int min_in_day_ = 1440;
     int no_result_requests_ = 0;
-    const SearchServer& search_server_;
-    
+    const SearchServer* search_server_ = nullptr;
+    const VersionedSearchServer* versioned_search_server_ = nullptr;
+
+    struct CachedResult {
+        std::string query_key;
+        std::vector<Document> documents;
+    };
+    // Most recently used first; the map keys are views of the list's query keys.
+    std::list<CachedResult> cached_results_;
+    std::unordered_map<std::string_view, std::list<CachedResult>::iterator> cached_result_positions_;
+    size_t cache_capacity_;
+    uint64_t cache_epoch_ = 0;
+    size_t cache_hits_ = 0;
+    size_t cache_misses_ = 0;
+
+    std::shared_ptr<const SearchServer> GetSearchServer() const;
+    std::vector<Document> FindTopDocumentsCached(const std::string& raw_query, DocumentStatus status);
+    static std::string MakeQueryKey(const SearchServer::QueryPlusAndMinusWords& query_plus_and_minus_words, DocumentStatus status);
     void CreateRequestsDeque(std::vector<Document> documents_found);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-    std::vector<Document> documents_found = search_server_.FindTopDocuments(raw_query, document_predicate);
+    std::vector<Document> documents_found = GetSearchServer()->FindTopDocuments(raw_query, document_predicate);
     CreateRequestsDeque(documents_found);
     return documents_found;
 }
\ No newline at end of file
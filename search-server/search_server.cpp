@@ -1,115 +1,638 @@
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory_resource>
 #include <numeric>
+#include <random>
+#include <thread>
 
 #include "search_server.h"
 #include "string_processing.h"
 
 using namespace std;
 
+namespace {
+
+const char INDEX_FILE_MAGIC[8] = { 'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0' };
+const uint32_t INDEX_FILE_VERSION = 3;
+const uint32_t INDEX_FILE_BYTE_ORDER = 0x01020304;
+
+// The header is followed by the stop words, the index words, their document
+// frequencies, the document ids by ordinal, the documents, their forward indexes
+// and the single merged segment, in that order. The forward index of the i-th
+// document is [offsets[i], offsets[i + 1]) of an array of document terms.
+struct IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t stop_word_count;
+    uint64_t term_count;
+    uint64_t ordinal_count;
+    uint64_t document_count;
+};
+
+struct StoredDocument {
+    int id;
+    int ordinal;
+    int average_document_rating;
+    int document_status;
+};
+
+// A batch document after tokenization: its words as term numbers local to its chunk.
+struct ParsedDocument {
+    string error;
+    vector<pair<int, int>> term_counts;
+    int word_count = 0;
+};
+
+// The partial index of a chunk of a batch. Terms are numbered locally, so the
+// tokenizing threads never touch the server's dictionary; postings hold the
+// positions of documents in the batch in ascending order.
+struct ParsedChunk {
+    vector<string_view> words;
+    vector<vector<pair<size_t, int>>> postings;
+};
+
+}
+
 SearchServer::SearchServer(const string& stop_words_string)
+    :SearchServer(string_view(stop_words_string))
+{
+}
+
+SearchServer::SearchServer(string_view stop_words_string)
     :SearchServer(SplitIntoWords(stop_words_string))
 {
 }
 
 int SearchServer::GetDocumentCount() const {
-    return static_cast<int>(document_id_.size());
+    return static_cast<int>(ordinals_by_id_.GetSize());
 }
 
-void SearchServer::AddDocument(int document_id, const string& document, DocumentStatus status, const vector<int>& ratings) {
-    if (document_id < 0 || documents_.count(document_id) == 1) {
+void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    if (document_id < 0 || ordinals_by_id_.Find(document_id) != nullptr) {
         throw invalid_argument("incorrect id"s);
     }
-    const vector<string> words = SplitIntoWordsNoStop(document);
-    document_id_.push_back(document_id);
-    map<string, double> words_tf;
-    double word_proportion = 1. / static_cast<double>(words.size());
-    for (const string& word : words) {
-        inverted_index_[word][document_id] += word_proportion;
+    const pmr::vector<string_view> words = SplitIntoWordsNoStop(document, pmr::get_default_resource());
+    InstallFinishedMerge(false);
+    const int ordinal = static_cast<int>(documents_.GetSize());
+    ordinals_by_id_.Insert(document_id, ordinal);
+    map<string_view, int> word_counts;
+    for (const string_view word : words) {
+        ++word_counts[word];
+    }
+    vector<DocumentTerm> document_terms;
+    document_terms.reserve(word_counts.size());
+    for (const auto& [word, count] : word_counts) {
+        const double tf = count / static_cast<double>(words.size());
+        const int term_id = FindOrAddTermId(word);
+        document_terms.push_back({ term_id, count });
+        active_postings_[term_id].push_back({ ordinal, count, tf });
+        TermData& term_data = *GetMutableTerm(term_id);
+        ++term_data.document_frequency;
+        UpdateDocumentFrequency(term_data);
+    }
+    DocumentData document_data = { document_id, ComputeAverageRating(ratings), status, 0, nullptr };
+    SetDocumentTerms(document_data, move(document_terms));
+    documents_.PushBack(move(document_data));
+    active_word_counts_.push_back(static_cast<int>(words.size()));
+    UpdateDocumentCount();
+    epoch_ = NextEpoch();
+    if (ordinal + 1 - active_ordinal_begin_ >= ACTIVE_SEGMENT_DOCUMENT_COUNT) {
+        SealActiveSegment();
+        StartMergeIfNeeded();
     }
-    documents_[document_id] = { ComputeAverageRating(ratings), status };
 }
 
-SearchServer::QueryPlusAndMinusWords SearchServer::FindQueryPlusAndMinusWords(const string& text) const {
-    QueryPlusAndMinusWords query_plus_and_minus_words;
-    for (const string& word : SplitIntoWordsNoStop(text)) {
-        if (word[0] == '-') {
-            query_plus_and_minus_words.minus_words.insert(word.substr(1, word.size() - 1));
+// Tokenizing, counting words and building the forward indexes run in parallel by
+// chunks. Only the dictionary and the postings lists are updated sequentially, one
+// lookup per distinct word of a chunk rather than per word of a document.
+vector<RejectedDocument> SearchServer::AddDocumentBatch(const vector<const NewDocument*>& documents) {
+    const size_t chunk_count = (documents.size() + BULK_ADD_CHUNK_DOCUMENT_COUNT - 1) / BULK_ADD_CHUNK_DOCUMENT_COUNT;
+    vector<ParsedDocument> parsed_documents(documents.size());
+    vector<ParsedChunk> chunks(chunk_count);
+    vector<size_t> chunk_indexes(chunk_count);
+    iota(chunk_indexes.begin(), chunk_indexes.end(), 0);
+    for_each(execution::par, chunk_indexes.begin(), chunk_indexes.end(), [&](size_t chunk_index) {
+        ParsedChunk& chunk = chunks[chunk_index];
+        const size_t chunk_begin = chunk_index * BULK_ADD_CHUNK_DOCUMENT_COUNT;
+        const size_t chunk_end = min(documents.size(), chunk_begin + BULK_ADD_CHUNK_DOCUMENT_COUNT);
+        unordered_map<string_view, int> local_term_ids;
+        for (size_t position = chunk_begin; position < chunk_end; ++position) {
+            ParsedDocument& parsed_document = parsed_documents[position];
+            if (documents[position]->id < 0 || ordinals_by_id_.Find(documents[position]->id) != nullptr) {
+                parsed_document.error = "incorrect id"s;
+                continue;
+            }
+            QueryArenaScope arena;
+            pmr::vector<int> term_ids(arena.GetResource());
+            try {
+                for (const string_view word : SplitIntoWordsNoStop(documents[position]->text, arena.GetResource())) {
+                    const auto [term_it, inserted] = local_term_ids.emplace(word, static_cast<int>(chunk.words.size()));
+                    if (inserted) {
+                        chunk.words.push_back(word);
+                        chunk.postings.emplace_back();
+                    }
+                    term_ids.push_back(term_it->second);
+                }
+            }
+            catch (const invalid_argument& error) {
+                parsed_document.error = error.what();
+                continue;
+            }
+            parsed_document.word_count = static_cast<int>(term_ids.size());
+            sort(term_ids.begin(), term_ids.end());
+            for (auto term_it = term_ids.begin(); term_it != term_ids.end();) {
+                const auto run_end = upper_bound(term_it, term_ids.end(), *term_it);
+                const int count = static_cast<int>(run_end - term_it);
+                parsed_document.term_counts.push_back({ *term_it, count });
+                chunk.postings[*term_it].push_back({ position, count });
+                term_it = run_end;
+            }
         }
-        else {
-            query_plus_and_minus_words.plus_words.insert(word);
+    });
+
+    InstallFinishedMerge(false);
+    vector<RejectedDocument> rejected_documents;
+    // The ordinal of every accepted document, or -1 for a rejected one.
+    vector<int> ordinals(documents.size(), -1);
+    int ordinal_end = static_cast<int>(documents_.GetSize());
+    for (size_t position = 0; position < documents.size(); ++position) {
+        const NewDocument& document = *documents[position];
+        const ParsedDocument& parsed_document = parsed_documents[position];
+        // The id is checked before the text, as in AddDocument; an earlier document of
+        // the batch may have taken it since the parallel pass.
+        const bool is_duplicate_id = ordinals_by_id_.Find(document.id) != nullptr;
+        if (is_duplicate_id || !parsed_document.error.empty()) {
+            rejected_documents.push_back({ position, document.id, is_duplicate_id ? "incorrect id"s : parsed_document.error });
+            continue;
         }
+        ordinals[position] = ordinal_end++;
+        ordinals_by_id_.Insert(document.id, ordinals[position]);
+        active_word_counts_.push_back(parsed_document.word_count);
     }
-    return query_plus_and_minus_words;
-}
 
-tuple<vector<string>, DocumentStatus> SearchServer::MatchDocument(const string& raw_query, int document_id) const {//(2.8.6)   -       
-    QueryPlusAndMinusWords query_plus_and_minus_words = FindQueryPlusAndMinusWords(raw_query);
-    vector<string> query_plus_words_in_document;
-    for (const string& word : query_plus_and_minus_words.plus_words) {
-        if (inverted_index_.count(word) != 0) {
-            map<int, double> inverted_index_id_tf = inverted_index_.at(word);
-            for (const auto& [id, tf] : inverted_index_id_tf) {
-                if (id == document_id) {
-                    query_plus_words_in_document.push_back(word);
+    // Chunks are taken in batch order, so the postings appended to a term stay sorted by ordinal.
+    vector<vector<int>> chunk_term_ids(chunk_count);
+    for (size_t chunk_index = 0; chunk_index < chunk_count; ++chunk_index) {
+        const ParsedChunk& chunk = chunks[chunk_index];
+        chunk_term_ids[chunk_index].resize(chunk.words.size());
+        for (size_t local_term_id = 0; local_term_id < chunk.words.size(); ++local_term_id) {
+            vector<Posting>* term_postings = nullptr;
+            TermData* term_data = nullptr;
+            for (const auto& [position, count] : chunk.postings[local_term_id]) {
+                if (ordinals[position] < 0) {
+                    continue;
                 }
+                if (term_postings == nullptr) {
+                    const int term_id = FindOrAddTermId(chunk.words[local_term_id]);
+                    chunk_term_ids[chunk_index][local_term_id] = term_id;
+                    term_postings = &active_postings_[term_id];
+                    term_data = GetMutableTerm(term_id);
+                }
+                term_postings->push_back({ ordinals[position], count, count / static_cast<double>(parsed_documents[position].word_count) });
+                ++term_data->document_frequency;
+            }
+            if (term_data != nullptr) {
+                UpdateDocumentFrequency(*term_data);
             }
         }
     }
-    for (const string& word : query_plus_and_minus_words.minus_words) {
-        if (inverted_index_.count(word) != 0) {
-            map<int, double> inverted_index_id_tf = inverted_index_.at(word);
-            for (const auto& [id, tf] : inverted_index_id_tf) {
-                if (id == document_id) {
-                    query_plus_words_in_document.clear();
-                    return tuple<vector<string>, DocumentStatus>{ query_plus_words_in_document, documents_.at(document_id).document_status };
-                }
+
+    vector<DocumentData> added_documents(documents.size());
+    for_each(execution::par, chunk_indexes.begin(), chunk_indexes.end(), [&](size_t chunk_index) {
+        const size_t chunk_begin = chunk_index * BULK_ADD_CHUNK_DOCUMENT_COUNT;
+        const size_t chunk_end = min(documents.size(), chunk_begin + BULK_ADD_CHUNK_DOCUMENT_COUNT);
+        for (size_t position = chunk_begin; position < chunk_end; ++position) {
+            if (ordinals[position] < 0) {
+                continue;
             }
+            const NewDocument& document = *documents[position];
+            vector<DocumentTerm> document_terms;
+            document_terms.reserve(parsed_documents[position].term_counts.size());
+            for (const auto& [local_term_id, count] : parsed_documents[position].term_counts) {
+                document_terms.push_back({ chunk_term_ids[chunk_index][local_term_id], count });
+            }
+            added_documents[position] = { document.id, ComputeAverageRating(document.ratings), document.status, 0, nullptr };
+            SetDocumentTerms(added_documents[position], move(document_terms));
+        }
+    });
+    // Accepted documents are appended in batch order, which is the order of their ordinals.
+    for (size_t position = 0; position < documents.size(); ++position) {
+        if (ordinals[position] >= 0) {
+            documents_.PushBack(move(added_documents[position]));
+        }
+    }
+
+    if (rejected_documents.size() < documents.size()) {
+        UpdateDocumentCount();
+        epoch_ = NextEpoch();
+    }
+    if (static_cast<int>(documents_.GetSize()) - active_ordinal_begin_ >= ACTIVE_SEGMENT_DOCUMENT_COUNT) {
+        SealActiveSegment();
+        StartMergeIfNeeded();
+    }
+    return rejected_documents;
+}
+
+void SearchServer::RemoveDocument(int document_id) {
+    RemoveDocument(execution::seq, document_id);
+}
+
+// The term ids are checked here, as a forward index read in place from a damaged
+// index file may name words missing from the dictionary; such a document has no
+// readable words.
+SearchServer::WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+    const DocumentData* document_data = FindDocument(document_id);
+    if (document_data == nullptr) {
+        return {};
+    }
+    const DocumentTerm* terms_begin = document_data->terms.get();
+    const DocumentTerm* terms_end = terms_begin + document_data->term_count;
+    int64_t word_count = 0;
+    for (const DocumentTerm* document_term = terms_begin; document_term != terms_end; ++document_term) {
+        if (document_term->term_id < 0 || static_cast<size_t>(document_term->term_id) >= terms_.GetSize()) {
+            return {};
+        }
+        word_count += document_term->term_count;
+    }
+    return WordFrequencies(this, terms_begin, static_cast<size_t>(document_data->term_count), static_cast<double>(word_count));
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::find(string_view word) const {
+    if (empty()) {
+        return end();
+    }
+    const int term_id = search_server_->FindTermId(word);
+    const DocumentTerm* terms_end = terms_ + term_count_;
+    const DocumentTerm* position = lower_bound(terms_, terms_end, term_id,
+        [](const DocumentTerm& document_term, int value) {
+            return document_term.term_id < value;
+        });
+    return term_id >= 0 && position != terms_end && position->term_id == term_id ? Iterator(search_server_, position, word_count_) : end();
+}
+
+size_t SearchServer::WordFrequencies::HashWords() const {
+    const hash<int> term_id_hasher;
+    size_t seed = term_count_;
+    for (const DocumentTerm* document_term = terms_; document_term != terms_ + term_count_; ++document_term) {
+        seed ^= term_id_hasher(document_term->term_id) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+}
+
+bool SearchServer::WordFrequencies::HasSameWords(const WordFrequencies& other) const {
+    if (term_count_ != other.term_count_) {
+        return false;
+    }
+    if (search_server_ == other.search_server_) {
+        return equal(terms_, terms_ + term_count_, other.terms_, [](const DocumentTerm& lhs, const DocumentTerm& rhs) {
+            return lhs.term_id == rhs.term_id;
+            });
+    }
+    return all_of(begin(), end(), [&other](const value_type& word_frequency) {
+        return other.count(word_frequency.first) == 1;
+        });
+}
+
+bool operator==(const SearchServer::WordFrequencies& lhs, const SearchServer::WordFrequencies& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    return all_of(lhs.begin(), lhs.end(), [&rhs](const SearchServer::WordFrequencies::value_type& word_frequency) {
+        const auto rhs_it = rhs.find(word_frequency.first);
+        return rhs_it != rhs.end() && rhs_it->second == word_frequency.second;
+        });
+}
+
+const SearchServer::DocumentData* SearchServer::FindDocument(int document_id) const {
+    const int* ordinal = ordinals_by_id_.Find(document_id);
+    return ordinal == nullptr ? nullptr : &documents_[static_cast<size_t>(*ordinal)];
+}
+
+void SearchServer::SetDocumentTerms(DocumentData& document_data, vector<DocumentTerm> document_terms) {
+    sort(document_terms.begin(), document_terms.end(), [](const DocumentTerm& lhs, const DocumentTerm& rhs) {
+        return lhs.term_id < rhs.term_id;
+        });
+    const auto owned_terms = make_shared<const vector<DocumentTerm>>(move(document_terms));
+    document_data.term_count = static_cast<int>(owned_terms->size());
+    document_data.terms = shared_ptr<const DocumentTerm>(owned_terms, owned_terms->data());
+}
+
+int SearchServer::FindDocumentTermId(const DocumentData& document_data, string_view word) const {
+    const int term_id = FindTermId(word);
+    if (term_id < 0) {
+        return -1;
+    }
+    const DocumentTerm* terms_end = document_data.terms.get() + document_data.term_count;
+    const DocumentTerm* position = lower_bound(document_data.terms.get(), terms_end, term_id,
+        [](const DocumentTerm& document_term, int value) {
+            return document_term.term_id < value;
+        });
+    return position != terms_end && position->term_id == term_id ? term_id : -1;
+}
+
+SearchServer::QueryPlusAndMinusWords SearchServer::FindQueryPlusAndMinusWords(string_view text, pmr::memory_resource* resource) const {
+    PROFILE_QUERY_STAGE(QueryStage::PARSE);
+    QueryPlusAndMinusWords query_plus_and_minus_words{ pmr::vector<string_view>(resource), pmr::vector<string_view>(resource) };
+    for (const string_view word : SplitIntoWordsNoStop(text, resource)) {
+        if (word[0] == '-') {
+            query_plus_and_minus_words.minus_words.push_back(word.substr(1));
         }
+        else {
+            query_plus_and_minus_words.plus_words.push_back(word);
+        }
+    }
+    for (pmr::vector<string_view>* words : { &query_plus_and_minus_words.plus_words, &query_plus_and_minus_words.minus_words }) {
+        sort(words->begin(), words->end());
+        words->erase(unique(words->begin(), words->end()), words->end());
     }
-    return tuple<vector<string>, DocumentStatus>{ query_plus_words_in_document, documents_.at(document_id).document_status };
+    return query_plus_and_minus_words;
+}
+
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(string_view raw_query, int document_id) const {//(2.8.6)   -       
+    return MatchDocument(execution::seq, raw_query, document_id);
 }
     
-vector<Document> SearchServer::FindTopDocuments(const string& raw_query, DocumentStatus status) const {
+vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
     return FindTopDocuments(raw_query, [status](int id, DocumentStatus document_status, int average_document_rating) {
         return status == document_status;
         });
 }
 
-vector<Document> SearchServer::FindTopDocuments(const string& raw_query) const {
+vector<Document> SearchServer::FindTopDocuments(string_view raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
-int SearchServer::GetDocumentId(int index) const {
-    return document_id_.at(index);
+vector<Document> SearchServer::FindTopDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, DocumentStatus status) const {
+    QueryArenaScope query_arena;
+    return FindTopDocuments(query_plus_and_minus_words, CountPlusWordIdfs(query_plus_and_minus_words, query_arena.GetResource()),
+        [status](int id, DocumentStatus document_status, int average_document_rating) {
+            return status == document_status;
+        });
+}
+
+SearchServer::DocumentIdIterator SearchServer::begin() const {
+    return ordinals_by_id_.KeysBegin();
 }
-    
-bool SearchServer::IsStopWord(const string& word) const {
-    return stop_words_.count(word) > 0;
+
+SearchServer::DocumentIdIterator SearchServer::end() const {
+    return ordinals_by_id_.KeysEnd();
 }
 
-vector<string> SearchServer::SplitIntoWordsNoStop(const string& text) const {
-    vector<string> words;
-    for (const string& word : SplitIntoWords(text)) {
-        if (!IsValidWord(text)) {
-            throw invalid_argument("query includes special characters");
+size_t SearchServer::GetMaxResultDocumentCount() const {
+    return max_result_document_count_;
+}
+
+void SearchServer::SetMaxResultDocumentCount(size_t max_result_document_count) {
+    max_result_document_count_ = max_result_document_count;
+    epoch_ = NextEpoch();
+}
+
+int SearchServer::GetDocumentFrequency(string_view word) const {
+    const int term_id = FindTermId(word);
+    return term_id < 0 ? 0 : terms_[term_id].document_frequency;
+}
+
+uint64_t SearchServer::GetEpoch() const {
+    return epoch_;
+}
+
+void SearchServer::MergeSegments() {
+    SealActiveSegment();
+    while (pending_merge_) {
+        InstallFinishedMerge(true);
+    }
+    if (segments_.size() > 1) {
+        segments_ = { MergeAllSegments(move(segments_)) };
+    }
+    CompactOrdinals();
+}
+
+size_t SearchServer::GetOrdinalCount() const {
+    return documents_.GetSize();
+}
+
+size_t SearchServer::GetChunkCount() const {
+    return documents_.GetChunkCount() + ordinals_by_id_.GetChunkCount() + term_ids_.GetChunkCount() + terms_.GetChunkCount()
+        + segments_.size();
+}
+
+size_t SearchServer::CountSharedChunks(const SearchServer& other) const {
+    const size_t shared_segment_count = static_cast<size_t>(count_if(segments_.begin(), segments_.end(),
+        [&other](const shared_ptr<const IndexSegment>& segment) {
+            return find(other.segments_.begin(), other.segments_.end(), segment) != other.segments_.end();
+        }));
+    return documents_.CountSharedChunks(other.documents_) + ordinals_by_id_.CountSharedChunks(other.ordinals_by_id_)
+        + term_ids_.CountSharedChunks(other.term_ids_) + terms_.CountSharedChunks(other.terms_) + shared_segment_count;
+}
+
+void SearchServer::Save(const string& path) const {
+    vector<shared_ptr<const IndexSegment>> segments = segments_;
+    const int ordinal_count = static_cast<int>(documents_.GetSize());
+    if (ordinal_count > active_ordinal_begin_) {
+        segments.push_back(make_shared<const IndexSegment>(active_ordinal_begin_, ordinal_count, active_postings_, active_word_counts_,
+            GetRemovedOrdinals(active_ordinal_begin_, ordinal_count)));
+    }
+    const shared_ptr<const IndexSegment> segment = segments.empty()
+        ? make_shared<const IndexSegment>(0, 0, unordered_map<int, vector<Posting>>{}, vector<int>{}, vector<bool>{})
+        : MergeAllSegments(move(segments));
+
+    // The file is written next to the target and renamed over it once complete, since
+    // truncating the target in place would pull the pages from under every server,
+    // here or in another process, that still maps it.
+    const string temporary_path = path + ".tmp"s + to_string(random_device{}());
+    ofstream output(temporary_path, ios::binary | ios::trunc);
+    if (!output) {
+        throw runtime_error("cannot create index file "s + path);
+    }
+    IndexFileHeader header{};
+    memcpy(header.magic, INDEX_FILE_MAGIC, sizeof(header.magic));
+    header.version = INDEX_FILE_VERSION;
+    header.byte_order = INDEX_FILE_BYTE_ORDER;
+    header.stop_word_count = stop_words_->size();
+    header.term_count = terms_.GetSize();
+    header.ordinal_count = documents_.GetSize();
+    header.document_count = ordinals_by_id_.GetSize();
+    WriteIndexValue(output, header);
+
+    WriteIndexStrings(output, vector<string_view>(stop_words_->begin(), stop_words_->end()));
+    vector<string_view> words;
+    words.reserve(terms_.GetSize());
+    vector<int> document_frequencies;
+    document_frequencies.reserve(terms_.GetSize());
+    for (size_t term_id = 0; term_id < terms_.GetSize(); ++term_id) {
+        words.push_back(terms_[term_id].word);
+        document_frequencies.push_back(terms_[term_id].document_frequency);
+    }
+    WriteIndexStrings(output, words);
+    WriteIndexArray(output, document_frequencies.data(), document_frequencies.size());
+    vector<int> document_ids_by_ordinal;
+    document_ids_by_ordinal.reserve(documents_.GetSize());
+    for (size_t ordinal = 0; ordinal < documents_.GetSize(); ++ordinal) {
+        document_ids_by_ordinal.push_back(documents_[ordinal].id);
+    }
+    WriteIndexArray(output, document_ids_by_ordinal.data(), document_ids_by_ordinal.size());
+    static_assert(sizeof(DocumentTerm) == 8, "document terms are stored in index files in their in-memory layout");
+    vector<StoredDocument> stored_documents;
+    stored_documents.reserve(ordinals_by_id_.GetSize());
+    vector<uint64_t> document_term_offsets = { 0 };
+    document_term_offsets.reserve(ordinals_by_id_.GetSize() + 1);
+    vector<DocumentTerm> document_terms;
+    ordinals_by_id_.ForEach([&](int id, int ordinal) {
+        const DocumentData& document_data = documents_[static_cast<size_t>(ordinal)];
+        stored_documents.push_back({ id, ordinal, document_data.average_document_rating, static_cast<int>(document_data.document_status) });
+        document_terms.insert(document_terms.end(), document_data.terms.get(), document_data.terms.get() + document_data.term_count);
+        document_term_offsets.push_back(document_terms.size());
+        });
+    WriteIndexArray(output, stored_documents.data(), stored_documents.size());
+    WriteIndexArray(output, document_term_offsets.data(), document_term_offsets.size());
+    WriteIndexArray(output, document_terms.data(), document_terms.size());
+    segment->Save(output);
+    output.close();
+    error_code error;
+    if (!output) {
+        filesystem::remove(temporary_path, error);
+        throw runtime_error("cannot write index file "s + path);
+    }
+    filesystem::rename(temporary_path, path, error);
+    if (error) {
+        filesystem::remove(temporary_path, error);
+        throw runtime_error("cannot replace index file "s + path);
+    }
+}
+
+SearchServer SearchServer::Open(const string& path) {
+    auto index_file = make_shared<const MappedFile>(path);
+    IndexFileReader reader(index_file->GetData(), index_file->GetSize());
+    const IndexFileHeader& header = reader.ReadValue<IndexFileHeader>();
+    if (memcmp(header.magic, INDEX_FILE_MAGIC, sizeof(header.magic)) != 0 || header.byte_order != INDEX_FILE_BYTE_ORDER) {
+        throw runtime_error("not an index file "s + path);
+    }
+    if (header.version != INDEX_FILE_VERSION) {
+        throw runtime_error("unsupported index file version "s + to_string(header.version));
+    }
+    if (header.stop_word_count > static_cast<uint64_t>(numeric_limits<int>::max())
+        || header.term_count > static_cast<uint64_t>(numeric_limits<int>::max())
+        || header.ordinal_count > static_cast<uint64_t>(numeric_limits<int>::max())
+        || header.document_count > header.ordinal_count) {
+        throw runtime_error("index file has a malformed header"s);
+    }
+    const size_t term_count = static_cast<size_t>(header.term_count);
+    const size_t ordinal_count = static_cast<size_t>(header.ordinal_count);
+    const size_t document_count = static_cast<size_t>(header.document_count);
+
+    SearchServer search_server;
+    const vector<string_view> stop_words = reader.ReadStrings(static_cast<size_t>(header.stop_word_count));
+    search_server.stop_words_ = make_shared<const set<string, less<>>>(stop_words.begin(), stop_words.end());
+    const vector<string_view> words = reader.ReadStrings(term_count);
+    const int* document_frequencies = reader.ReadArray<int>(term_count);
+    vector<pair<TermKey, int>> term_ids;
+    term_ids.reserve(term_count);
+    for (size_t term_id = 0; term_id < term_count; ++term_id) {
+        // A word whose documents were all removed keeps a zero frequency and is never ranked.
+        if (document_frequencies[term_id] < 0 || static_cast<size_t>(document_frequencies[term_id]) > document_count) {
+            throw runtime_error("index file has a malformed dictionary"s);
         }
+        term_ids.push_back({ MakeTermKey(words[term_id]), static_cast<int>(term_id) });
+        TermData term_data{ document_frequencies[term_id], 0.0, words[term_id] };
+        UpdateDocumentFrequency(term_data);
+        search_server.terms_.PushBack(term_data);
+    }
+    sort(term_ids.begin(), term_ids.end(), [](const pair<TermKey, int>& lhs, const pair<TermKey, int>& rhs) {
+        return lhs.first < rhs.first;
+        });
+    if (adjacent_find(term_ids.begin(), term_ids.end(), [](const pair<TermKey, int>& lhs, const pair<TermKey, int>& rhs) {
+        return lhs.first.word == rhs.first.word;
+        }) != term_ids.end()) {
+        throw runtime_error("index file has a malformed dictionary"s);
+    }
+    search_server.term_ids_.Assign(move(term_ids));
+    const int* document_ids_by_ordinal = reader.ReadArray<int>(ordinal_count);
+    if (static_cast<size_t>(count_if(document_ids_by_ordinal, document_ids_by_ordinal + ordinal_count, [](int id) { return id != REMOVED_DOCUMENT_ID; })) != document_count) {
+        throw runtime_error("index file has a malformed document table"s);
+    }
+
+    const StoredDocument* stored_documents = reader.ReadArray<StoredDocument>(document_count);
+    const uint64_t* document_term_offsets = reader.ReadArray<uint64_t>(document_count + 1);
+    const uint64_t document_term_count = document_term_offsets[document_count];
+    if (document_term_offsets[0] != 0 || document_term_count >= numeric_limits<size_t>::max()) {
+        throw runtime_error("index file has a malformed forward index"s);
+    }
+    const DocumentTerm* document_terms = reader.ReadArray<DocumentTerm>(static_cast<size_t>(document_term_count));
+    vector<DocumentData> documents(ordinal_count, DocumentData{ REMOVED_DOCUMENT_ID, 0, DocumentStatus::REMOVED, 0, nullptr });
+    vector<pair<int, int>> ordinals_by_id;
+    ordinals_by_id.reserve(document_count);
+    for (size_t i = 0; i < document_count; ++i) {
+        const StoredDocument& stored_document = stored_documents[i];
+        if (stored_document.id < 0 || stored_document.ordinal < 0 || static_cast<size_t>(stored_document.ordinal) >= ordinal_count
+            || document_ids_by_ordinal[stored_document.ordinal] != stored_document.id
+            || stored_document.document_status < static_cast<int>(DocumentStatus::ACTUAL)
+            || stored_document.document_status > static_cast<int>(DocumentStatus::REMOVED)) {
+            throw runtime_error("index file has a malformed document table"s);
+        }
+        if (document_term_offsets[i] > document_term_offsets[i + 1] || document_term_offsets[i + 1] > document_term_count
+            || document_term_offsets[i + 1] - document_term_offsets[i] > static_cast<uint64_t>(numeric_limits<int>::max())) {
+            throw runtime_error("index file has a malformed forward index"s);
+        }
+        documents[static_cast<size_t>(stored_document.ordinal)] = { stored_document.id, stored_document.average_document_rating,
+            static_cast<DocumentStatus>(stored_document.document_status),
+            static_cast<int>(document_term_offsets[i + 1] - document_term_offsets[i]),
+            shared_ptr<const DocumentTerm>(index_file, document_terms + document_term_offsets[i]) };
+        ordinals_by_id.push_back({ stored_document.id, stored_document.ordinal });
+    }
+    sort(ordinals_by_id.begin(), ordinals_by_id.end());
+    if (adjacent_find(ordinals_by_id.begin(), ordinals_by_id.end(), [](const pair<int, int>& lhs, const pair<int, int>& rhs) {
+        return lhs.first == rhs.first;
+        }) != ordinals_by_id.end()) {
+        throw runtime_error("index file has a malformed document table"s);
+    }
+    for (DocumentData& document_data : documents) {
+        search_server.documents_.PushBack(move(document_data));
+    }
+    search_server.ordinals_by_id_.Assign(move(ordinals_by_id));
+    shared_ptr<const IndexSegment> segment = IndexSegment::Open(reader, index_file);
+    if (segment->GetOrdinalBegin() != 0 || static_cast<size_t>(segment->GetOrdinalEnd()) != ordinal_count) {
+        throw runtime_error("index file has a malformed segment"s);
+    }
+    if (ordinal_count > 0) {
+        search_server.segments_.push_back(move(segment));
+    }
+    search_server.active_ordinal_begin_ = static_cast<int>(ordinal_count);
+    search_server.UpdateDocumentCount();
+    search_server.index_file_ = move(index_file);
+    return search_server;
+}
+    
+bool SearchServer::IsStopWord(string_view word) const {
+    return stop_words_->count(word) > 0;
+}
+
+pmr::vector<string_view> SearchServer::SplitIntoWordsNoStop(string_view text, pmr::memory_resource* resource) const {
+    optional<pmr::vector<string_view>> words = SplitIntoValidWords(text, resource);
+    if (!words) {
+        throw invalid_argument("query includes special characters");
+    }
+    for (const string_view word : *words) {
         if (!IsValidByMinus(word)) {
             throw invalid_argument("incorrect using minuses");
         }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
-        }
     }
-    return words;
+    words->erase(remove_if(words->begin(), words->end(), [this](string_view word) {
+        return IsStopWord(word);
+        }), words->end());
+    return move(*words);
 }
 
-bool SearchServer::IsValidWord(const string& text) {
-    return none_of(text.begin(), text.end(), [](char c) {
-        return c >= '\0' && c < ' ';
-        });
+bool SearchServer::IsValidWord(string_view text) {
+    return !ContainsControlCharacters(text);
 }
 
-bool SearchServer::IsValidByMinus(const string& word) {
+bool SearchServer::IsValidByMinus(string_view word) {
     if (word.size() == 1 && word[0] == '-') {
         return false;
     }
@@ -128,12 +651,341 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     }
 }
 
-double SearchServer::CountIdf(const map<int, double>& inverted_index_id_tf) const {
-    return log(static_cast<double>(document_id_.size()) / static_cast<double>(inverted_index_id_tf.size()));
+uint64_t SearchServer::NextEpoch() {
+    static atomic<uint64_t> last_epoch{ 0 };
+    return ++last_epoch;
 }
 
-vector<Document> SearchServer::FindAllDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, DocumentStatus status) const {
-    return FindAllDocuments(query_plus_and_minus_words, [status](int id, DocumentStatus document_status, int average_document_rating) {
-        return status == document_status;
+double SearchServer::CountIdf(int term_id) const {
+    return log_document_count_ - terms_[term_id].log_document_frequency;
+}
+
+pmr::vector<double> SearchServer::CountPlusWordIdfs(const QueryPlusAndMinusWords& query_plus_and_minus_words, pmr::memory_resource* resource) const {
+    PROFILE_QUERY_STAGE(QueryStage::PARSE);
+    pmr::vector<double> plus_word_idfs(resource);
+    plus_word_idfs.reserve(query_plus_and_minus_words.plus_words.size());
+    for (const string_view word : query_plus_and_minus_words.plus_words) {
+        const int term_id = FindTermId(word);
+        plus_word_idfs.push_back(term_id < 0 ? 0.0 : CountIdf(term_id));
+    }
+    return plus_word_idfs;
+}
+
+SearchServer::TermKey SearchServer::MakeTermKey(string_view word) {
+    return { hash<string_view>{}(word), word };
+}
+
+int SearchServer::FindTermId(string_view word) const {
+    const int* term_id = term_ids_.Find(MakeTermKey(word));
+    if (term_id == nullptr || terms_[static_cast<size_t>(*term_id)].document_frequency == 0) {
+        return -1;
+    }
+    return *term_id;
+}
+
+int SearchServer::FindOrAddTermId(string_view word) {
+    const TermKey term_key = MakeTermKey(word);
+    if (const int* term_id = term_ids_.Find(term_key)) {
+        return *term_id;
+    }
+    const int term_id = static_cast<int>(terms_.GetSize());
+    const string_view stored_word = word_storage_->Add(word);
+    term_ids_.Insert({ term_key.hash, stored_word }, term_id);
+    terms_.PushBack({ 0, 0.0, stored_word });
+    return term_id;
+}
+
+SearchServer::TermData* SearchServer::GetMutableTerm(int term_id) {
+    if (term_id < 0 || static_cast<size_t>(term_id) >= terms_.GetSize()) {
+        return nullptr;
+    }
+    return &terms_.GetMutable(static_cast<size_t>(term_id));
+}
+
+pmr::vector<int> SearchServer::FindTermIds(const pmr::vector<string_view>& words, pmr::memory_resource* resource) const {
+    pmr::vector<int> term_ids(resource);
+    term_ids.reserve(words.size());
+    for (const string_view word : words) {
+        term_ids.push_back(FindTermId(word));
+    }
+    return term_ids;
+}
+
+size_t SearchServer::SumDocumentFrequencies(const pmr::vector<int>& term_ids) const {
+    size_t document_frequency_sum = 0;
+    for (const int term_id : term_ids) {
+        if (term_id >= 0) {
+            document_frequency_sum += static_cast<size_t>(terms_[term_id].document_frequency);
+        }
+    }
+    return document_frequency_sum;
+}
+
+SearchServer::TermPostingCursor::TermPostingCursor(const SearchServer& search_server, int term_id)
+    : search_server_(&search_server)
+    , term_id_(term_id)
+{
+    const auto active_it = search_server.active_postings_.find(term_id);
+    if (active_it != search_server.active_postings_.end()) {
+        active_position_ = active_it->second.data();
+        active_end_ = active_it->second.data() + active_it->second.size();
+    }
+}
+
+bool SearchServer::TermPostingCursor::Contains(int ordinal) {
+    if (ordinal >= search_server_->active_ordinal_begin_) {
+        active_position_ = GallopLowerBound(active_position_, active_end_, ordinal,
+            [](const Posting& posting, int value) {
+                return posting.ordinal < value;
+            });
+        return active_position_ != active_end_ && active_position_->ordinal == ordinal;
+    }
+    const vector<shared_ptr<const IndexSegment>>& segments = search_server_->segments_;
+    while (segments[segment_index_]->GetOrdinalEnd() <= ordinal) {
+        ++segment_index_;
+        segment_cursor_.reset();
+    }
+    if (!segment_cursor_) {
+        segment_cursor_.emplace(*segments[segment_index_], term_id_);
+    }
+    return segment_cursor_->Contains(ordinal);
+}
+
+pmr::vector<SearchServer::TermPostingCursor> SearchServer::CreateTermPostingCursors(const pmr::vector<string_view>& words, pmr::memory_resource* resource) const {
+    pmr::vector<TermPostingCursor> term_posting_cursors(resource);
+    for (const string_view word : words) {
+        const int term_id = FindTermId(word);
+        if (term_id >= 0) {
+            term_posting_cursors.emplace_back(*this, term_id);
+        }
+    }
+    return term_posting_cursors;
+}
+
+bool SearchServer::ContainsAnyTerm(pmr::vector<TermPostingCursor>& term_posting_cursors, int ordinal) {
+    if (term_posting_cursors.empty()) {
+        return false;
+    }
+    PROFILE_QUERY_STAGE(QueryStage::MINUS_WORDS);
+    for (TermPostingCursor& term_posting_cursor : term_posting_cursors) {
+        if (term_posting_cursor.Contains(ordinal)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SearchServer::DecreaseDocumentFrequency(int term_id) {
+    TermData* term_data = GetMutableTerm(term_id);
+    if (term_data == nullptr) {
+        return;
+    }
+    --term_data->document_frequency;
+    UpdateDocumentFrequency(*term_data);
+}
+
+void SearchServer::UpdateDocumentFrequency(TermData& term_data) {
+    term_data.log_document_frequency = log(static_cast<double>(term_data.document_frequency));
+}
+
+string_view SearchServer::WordStorage::Add(string_view word) {
+    lock_guard guard(mutex_);
+    return words_.emplace_back(word);
+}
+
+void SearchServer::UpdateDocumentCount() {
+    log_document_count_ = log(static_cast<double>(ordinals_by_id_.GetSize()));
+}
+
+vector<bool> SearchServer::GetRemovedOrdinals(int ordinal_begin, int ordinal_end) const {
+    vector<bool> is_removed(static_cast<size_t>(ordinal_end - ordinal_begin));
+    for (int ordinal = ordinal_begin; ordinal < ordinal_end; ++ordinal) {
+        is_removed[static_cast<size_t>(ordinal - ordinal_begin)] = documents_[static_cast<size_t>(ordinal)].id == REMOVED_DOCUMENT_ID;
+    }
+    return is_removed;
+}
+
+void SearchServer::SealActiveSegment() {
+    const int ordinal_end = static_cast<int>(documents_.GetSize());
+    if (ordinal_end == active_ordinal_begin_) {
+        return;
+    }
+    segments_.push_back(make_shared<const IndexSegment>(active_ordinal_begin_, ordinal_end, active_postings_, active_word_counts_,
+        GetRemovedOrdinals(active_ordinal_begin_, ordinal_end)));
+    active_postings_.clear();
+    active_word_counts_.clear();
+    active_ordinal_begin_ = ordinal_end;
+}
+
+// The two newest segments are merged once the older one is no more than
+// SEGMENT_MERGE_FACTOR times larger, so segment sizes grow geometrically and every
+// posting is rewritten O(log n) times. The merge runs on its own thread; the
+// result is installed by the next write.
+void SearchServer::StartMergeIfNeeded() {
+    if (pending_merge_ || segments_.size() < 2) {
+        return;
+    }
+    const shared_ptr<const IndexSegment> older = segments_[segments_.size() - 2];
+    const shared_ptr<const IndexSegment> newer = segments_.back();
+    if (older->GetPostingCount() > SEGMENT_MERGE_FACTOR * newer->GetPostingCount()) {
+        return;
+    }
+    vector<bool> is_removed = GetRemovedOrdinals(older->GetOrdinalBegin(), newer->GetOrdinalEnd());
+    pending_merge_ = PendingMerge{ older, newer,
+        async(launch::async, [older, newer, is_removed = move(is_removed)]() {
+            return IndexSegment::Merge(*older, *newer, is_removed);
+        }).share() };
+}
+
+void SearchServer::InstallFinishedMerge(bool wait) {
+    if (!pending_merge_) {
+        return;
+    }
+    if (!wait && pending_merge_->merged.wait_for(chrono::seconds(0)) != future_status::ready) {
+        return;
+    }
+    const PendingMerge merge = move(*pending_merge_);
+    pending_merge_.reset();
+    const auto older_it = find(segments_.begin(), segments_.end(), merge.older);
+    if (older_it != segments_.end() && next(older_it) != segments_.end() && *next(older_it) == merge.newer) {
+        *older_it = merge.merged.get();
+        segments_.erase(next(older_it));
+    }
+    StartMergeIfNeeded();
+}
+
+shared_ptr<const IndexSegment> SearchServer::MergeAllSegments(vector<shared_ptr<const IndexSegment>> segments) const {
+    while (segments.size() > 1) {
+        const shared_ptr<const IndexSegment>& older = segments[segments.size() - 2];
+        const shared_ptr<const IndexSegment>& newer = segments.back();
+        shared_ptr<const IndexSegment> merged = IndexSegment::Merge(*older, *newer,
+            GetRemovedOrdinals(older->GetOrdinalBegin(), newer->GetOrdinalEnd()));
+        segments.pop_back();
+        segments.back() = move(merged);
+    }
+    return segments.back();
+}
+
+void SearchServer::CompactOrdinalsIfNeeded() {
+    const size_t removed_ordinal_count = documents_.GetSize() - ordinals_by_id_.GetSize();
+    if (removed_ordinal_count >= ORDINAL_COMPACTION_MIN_REMOVED_COUNT && removed_ordinal_count > ordinals_by_id_.GetSize()) {
+        CompactOrdinals();
+    }
+}
+
+// Live documents keep their relative order, so postings stay sorted and every query
+// returns the same documents with the same relevance. Compaction rewrites every
+// posting, and it runs only after as many removals as there are live documents left,
+// so its cost is amortized over those removals.
+void SearchServer::CompactOrdinals() {
+    if (documents_.GetSize() == ordinals_by_id_.GetSize()) {
+        return;
+    }
+    SealActiveSegment();
+    while (pending_merge_) {
+        InstallFinishedMerge(true);
+    }
+    vector<int> new_ordinals(documents_.GetSize(), -1);
+    ChunkedVector<DocumentData, DOCUMENT_CHUNK_SIZE> documents;
+    for (size_t ordinal = 0; ordinal < documents_.GetSize(); ++ordinal) {
+        if (documents_[ordinal].id != REMOVED_DOCUMENT_ID) {
+            new_ordinals[ordinal] = static_cast<int>(documents.GetSize());
+            documents.PushBack(documents_[ordinal]);
+        }
+    }
+    const int ordinal_count = static_cast<int>(documents.GetSize());
+    const shared_ptr<const IndexSegment> merged = MergeAllSegments(move(segments_));
+    segments_.clear();
+    if (ordinal_count > 0) {
+        segments_.push_back(IndexSegment::Renumber(*merged, new_ordinals, ordinal_count));
+    }
+    vector<pair<int, int>> ordinals_by_id;
+    ordinals_by_id.reserve(ordinals_by_id_.GetSize());
+    ordinals_by_id_.ForEach([&ordinals_by_id, &new_ordinals](int id, int ordinal) {
+        ordinals_by_id.push_back({ id, new_ordinals[static_cast<size_t>(ordinal)] });
         });
+    ordinals_by_id_.Assign(move(ordinals_by_id));
+    documents_ = move(documents);
+    active_ordinal_begin_ = ordinal_count;
+}
+
+// The ordinals are scored in ranges no longer than MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT,
+// so a broad query can use the dense array however large the corpus is. The ranges
+// are scored in order, so the candidates stay sorted by ordinal.
+pmr::vector<pair<int, double>> SearchServer::AccumulateRelevance(const QueryPlusAndMinusWords& query_plus_and_minus_words, const pmr::vector<double>& plus_word_idfs, pmr::memory_resource* resource) const {
+    PROFILE_QUERY_STAGE(QueryStage::POSTINGS);
+    const pmr::vector<int> plus_term_ids = FindTermIds(query_plus_and_minus_words.plus_words, resource);
+    const int ordinal_count = static_cast<int>(documents_.GetSize());
+    const size_t expected_candidate_count = SumDocumentFrequencies(plus_term_ids);
+    pmr::vector<pair<int, double>> candidates(resource);
+    for (int range_begin = 0; range_begin < ordinal_count;) {
+        const int range_end = static_cast<int>(min<int64_t>(ordinal_count, int64_t{ range_begin } + static_cast<int64_t>(MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT)));
+        const size_t range_candidate_count = static_cast<size_t>(static_cast<double>(expected_candidate_count) * (range_end - range_begin) / ordinal_count);
+        RelevanceAccumulator ordinal_relevance(range_begin, range_end, range_candidate_count, resource);
+        for (size_t i = 0; i < plus_term_ids.size(); ++i) {
+            if (plus_term_ids[i] < 0) {
+                continue;
+            }
+            const double query_word_idf = plus_word_idfs[i];
+            ForEachPosting(plus_term_ids[i], range_begin, range_end, [&ordinal_relevance, query_word_idf](const Posting& posting) {
+                ordinal_relevance.Add(posting.ordinal, posting.term_frequency * query_word_idf);
+                PROFILE_QUERY_COUNT(QueryCounter::POSTINGS_SCANNED, 1);
+            });
+        }
+        if (candidates.empty()) {
+            candidates = ordinal_relevance.GetSortedCandidates();
+        }
+        else {
+            const pmr::vector<pair<int, double>> range_candidates = ordinal_relevance.GetSortedCandidates();
+            candidates.insert(candidates.end(), range_candidates.begin(), range_candidates.end());
+        }
+        range_begin = range_end;
+    }
+    return candidates;
+}
+
+// Chunks are also kept within MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT ordinals, so each
+// can be scored densely when there are fewer threads than the corpus needs chunks.
+vector<int> SearchServer::SplitOrdinals() const {
+    const int ordinal_count = static_cast<int>(documents_.GetSize());
+    const size_t max_chunk_count = max(thread::hardware_concurrency(), 1u) * PARALLEL_QUERY_CHUNKS_PER_THREAD;
+    const size_t dense_chunk_count = (static_cast<size_t>(ordinal_count) + MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT - 1) / MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT;
+    const size_t chunk_count = max(dense_chunk_count,
+        clamp<size_t>(static_cast<size_t>(ordinal_count / PARALLEL_QUERY_MIN_CHUNK_ORDINAL_COUNT), 1, max_chunk_count));
+    vector<int> chunk_bounds;
+    chunk_bounds.reserve(chunk_count + 1);
+    for (size_t i = 0; i <= chunk_count; ++i) {
+        chunk_bounds.push_back(static_cast<int>(static_cast<int64_t>(ordinal_count) * static_cast<int64_t>(i) / static_cast<int64_t>(chunk_count)));
+    }
+    return chunk_bounds;
+}
+
+pmr::vector<Document> SearchServer::FindAllDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, const pmr::vector<double>& plus_word_idfs, DocumentStatus status, pmr::memory_resource* resource) const {
+    return FindAllDocuments(query_plus_and_minus_words, plus_word_idfs, [status](int id, DocumentStatus document_status, int average_document_rating) {
+        return status == document_status;
+        }, resource);
+}
+
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (abs(lhs.relevance - rhs.relevance) >= EPSILON) {
+        return lhs.relevance > rhs.relevance;
+    }
+    return lhs.rating != rhs.rating ? lhs.rating > rhs.rating : lhs.id < rhs.id;
+}
+
+// Only the first max_result_document_count_ documents are ordered: partial_sort keeps
+// them in a bounded heap, so a broad query costs O(n log k) instead of a full sort.
+// The selection is sequential even for a parallel search: it is small next to the
+// scan, and selecting from the same candidates in the same order keeps the parallel
+// results identical to the sequential ones.
+void SearchServer::SelectTopDocuments(pmr::vector<Document>& matched_documents) const {
+    PROFILE_QUERY_STAGE(QueryStage::SELECT_TOP);
+    if (matched_documents.size() > max_result_document_count_) {
+        const auto top_end = matched_documents.begin() + static_cast<ptrdiff_t>(max_result_document_count_);
+        partial_sort(matched_documents.begin(), top_end, matched_documents.end(), IsMoreRelevant);
+        matched_documents.erase(top_end, matched_documents.end());
+    }
+    else {
+        sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    }
 }
\ No newline at end of file
@@ -1,122 +1,688 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <execution>
+#include <future>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
+#include "chunked_containers.h"
 #include "document.h"
+#include "index_segment.h"
+#include "query_arena.h"
+#include "query_profile.h"
+#include "relevance_accumulator.h"
 
 using namespace std::literals::string_literals;
 
 const double EPSILON = 1e-6;
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
+const int ACTIVE_SEGMENT_DOCUMENT_COUNT = 4096;
+const size_t SEGMENT_MERGE_FACTOR = 2;
+const size_t BULK_ADD_CHUNK_DOCUMENT_COUNT = 1024;
+// A parallel query splits the ordinals into chunks of at least this many ordinals,
+// with up to PARALLEL_QUERY_CHUNKS_PER_THREAD chunks per hardware thread.
+const int PARALLEL_QUERY_MIN_CHUNK_ORDINAL_COUNT = 4096;
+const unsigned PARALLEL_QUERY_CHUNKS_PER_THREAD = 4;
+// Ordinals are compacted once removed documents outnumber the live ones and there
+// are at least this many of them.
+const size_t ORDINAL_COMPACTION_MIN_REMOVED_COUNT = 4096;
+// Chunk sizes of the copy-on-write tables, see chunked_containers.h.
+const size_t DOCUMENT_CHUNK_SIZE = 1024;
+const size_t DOCUMENT_ID_LEAF_SIZE = 256;
+const size_t TERM_CHUNK_SIZE = 256;
+const size_t TERM_ID_LEAF_SIZE = 128;
+
+template <typename ExecutionPolicy>
+using EnableIfExecutionPolicy = std::enable_if_t<std::is_execution_policy_v<std::decay_t<ExecutionPolicy>>, bool>;
 
 class SearchServer {
 public:
     template <typename StringContainer>
     explicit SearchServer(const StringContainer& stop_words_container);
     explicit SearchServer(const std::string& stop_words_string);
+    explicit SearchServer(std::string_view stop_words_string);
     SearchServer() = default;
 
     int GetDocumentCount() const;
 
-    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    // Adds a range of NewDocument. Documents are tokenized in parallel, and the batch
+    // is merged into the index in one pass. A document that AddDocument would reject
+    // is skipped and reported; the rest of the batch is still added.
+    template <typename DocumentRange>
+    std::vector<RejectedDocument> AddDocuments(const DocumentRange& documents);
+
+    void RemoveDocument(int document_id);
+    template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+    void RemoveDocument(ExecutionPolicy&& policy, int document_id);
+
+    // The words of a document with their term frequencies, read in place from the
+    // document's forward index. The view refers into the server and stays valid until
+    // the server is changed. It is empty for an unknown id.
+    class WordFrequencies;
+    WordFrequencies GetWordFrequencies(int document_id) const;
 
     struct QueryPlusAndMinusWords {
-        std::set<std::string> plus_words;
-        std::set<std::string> minus_words;
+        std::pmr::vector<std::string_view> plus_words;
+        std::pmr::vector<std::string_view> minus_words;
     };
 
-    QueryPlusAndMinusWords FindQueryPlusAndMinusWords(const std::string& text) const;
+    QueryPlusAndMinusWords FindQueryPlusAndMinusWords(std::string_view text, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+    // Matched words are sorted and deduplicated views of the server's own words, valid
+    // for as long as the server or any of its copies exists.
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+    template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExecutionPolicy&& policy, std::string_view raw_query, int document_id) const;
 
-    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
+    template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const;
+    template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
 
+    // Ranks with the given IDF of every plus word instead of the server's own
+    // statistics, so servers holding parts of one collection rank their documents
+    // as a single server would.
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const;
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus status) const;
-    std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
+    std::vector<Document> FindTopDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, const std::pmr::vector<double>& plus_word_idfs, DocumentPredicate document_predicate) const;
+    // Ranks an already parsed query with the server's own statistics, for callers
+    // that need the parsed query themselves.
+    std::vector<Document> FindTopDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, DocumentStatus status) const;
+    int GetDocumentFrequency(std::string_view word) const;
+    // The order of FindTopDocuments results: by relevance, then by rating, and
+    // documents equal in both by ascending id.
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+    using DocumentIdIterator = ChunkedMap<int, int, DOCUMENT_ID_LEAF_SIZE>::KeyIterator;
+
+    // Document ids in ascending order.
+    DocumentIdIterator begin() const;
+    DocumentIdIterator end() const;
 
-    int GetDocumentId(int index) const;
+    size_t GetMaxResultDocumentCount() const;
+    void SetMaxResultDocumentCount(size_t max_result_document_count);
+
+    // Changes whenever a change to the server may change query results. Epochs are
+    // unique across all servers; a copy keeps the epoch until either copy changes.
+    uint64_t GetEpoch() const;
+
+    // Seals the active segment, waits for the background merge, merges all segments
+    // into one and compacts the ordinals of removed documents away.
+    void MergeSegments();
+    // Live documents plus removed ones whose ordinals are not compacted yet; removed
+    // ones number at most the larger of the live documents and
+    // ORDINAL_COMPACTION_MIN_REMOVED_COUNT.
+    size_t GetOrdinalCount() const;
+
+    // A copy of the server shares the chunks of its tables and its sealed segments with
+    // the original, and a change copies only the chunks it touches, so a copy costs
+    // the active segment plus one pointer per chunk. These count the chunks and sealed
+    // segments of the server and those it shares with other, e.g. an earlier copy.
+    size_t GetChunkCount() const;
+    size_t CountSharedChunks(const SearchServer& other) const;
+
+    // Writes the index to a versioned binary file. Open maps the file back: postings,
+    // words and the forward index are read in place from the mapping, and only the
+    // document table and the dictionary are rebuilt. Posting blocks are checked
+    // against their headers at open and decoded when a query first reads them.
+    void Save(const std::string& path) const;
+    static SearchServer Open(const std::string& path);
 
 private:
-    std::set<std::string> stop_words_;
-    std::vector<int> document_id_;
+    std::shared_ptr<const std::set<std::string, std::less<>>> stop_words_ = std::make_shared<const std::set<std::string, std::less<>>>();
+    // An entry of a document's forward index; the term frequency is term_count over
+    // the sum of the term counts of the document.
+    struct DocumentTerm {
+        int term_id;
+        int term_count;
+    };
     struct DocumentData {
+        int id;
         int average_document_rating;
         DocumentStatus document_status;
+        int term_count;
+        // Sorted by term id. The pointer shares ownership of the memory it points into:
+        // the document's own array, or the mapped file of an opened server, whose term
+        // ids are bounds-checked where they are used.
+        std::shared_ptr<const DocumentTerm> terms;
+    };
+    // Documents by ordinal. A removed document keeps its ordinal with id
+    // REMOVED_DOCUMENT_ID and no terms until the ordinals are compacted.
+    ChunkedVector<DocumentData, DOCUMENT_CHUNK_SIZE> documents_;
+    ChunkedMap<int, int, DOCUMENT_ID_LEAF_SIZE> ordinals_by_id_;
+    size_t max_result_document_count_ = MAX_RESULT_DOCUMENT_COUNT;
+    uint64_t epoch_ = NextEpoch();
+    // Index words are interned into storage shared by all copies of the server. It only
+    // grows and std::deque never moves its elements, so the views below stay valid in
+    // every copy, and a copy can add words while another one is being read.
+    class WordStorage {
+    public:
+        std::string_view Add(std::string_view word);
+
+    private:
+        std::mutex mutex_;
+        std::deque<std::string> words_;
+    };
+    std::shared_ptr<WordStorage> word_storage_ = std::make_shared<WordStorage>();
+    // The dictionary orders words by hash first, so a lookup compares integers and
+    // compares words only when their hashes are equal.
+    struct TermKey {
+        size_t hash;
+        std::string_view word;
+
+        friend bool operator<(const TermKey& lhs, const TermKey& rhs) {
+            return lhs.hash != rhs.hash ? lhs.hash < rhs.hash : lhs.word < rhs.word;
+        }
+    };
+    ChunkedMap<TermKey, int, TERM_ID_LEAF_SIZE> term_ids_;
+    // The document frequency of every term and its logarithm are updated whenever a
+    // document is added or removed, so a query computes IDF without calling log.
+    struct TermData {
+        int document_frequency = 0;
+        double log_document_frequency = 0.0;
+        std::string_view word;
+    };
+    ChunkedVector<TermData, TERM_CHUNK_SIZE> terms_;
+    double log_document_count_ = 0.0;
+
+    // Every added document gets the next ordinal, which is never reused. Postings refer
+    // to documents by ordinal, so they stay sorted however ids arrive, and postings of a
+    // removed document are simply skipped until a merge drops them. Ordinals of removed
+    // documents are compacted away when they outnumber the live ones: all segments are
+    // merged and renumbered densely in the order of the old ordinals.
+    static const int REMOVED_DOCUMENT_ID = -1;
+
+    // New documents go to the small mutable active segment. When it is full, it is
+    // sealed into an immutable IndexSegment, and sealed segments are merged in the
+    // background. Copies of the server share sealed segments.
+    std::unordered_map<int, std::vector<Posting>> active_postings_;
+    std::vector<int> active_word_counts_;
+    int active_ordinal_begin_ = 0;
+    std::vector<std::shared_ptr<const IndexSegment>> segments_;
+    struct PendingMerge {
+        std::shared_ptr<const IndexSegment> older;
+        std::shared_ptr<const IndexSegment> newer;
+        std::shared_future<std::shared_ptr<const IndexSegment>> merged;
+    };
+    std::optional<PendingMerge> pending_merge_;
+    // Words and sealed postings of an opened server point into the mapped index file.
+    std::shared_ptr<const MappedFile> index_file_;
+
+    // Tells whether documents have a posting of one term, for ordinals asked in
+    // ascending order, by galloping through the segments; see IndexSegment::TermCursor.
+    class TermPostingCursor {
+    public:
+        TermPostingCursor(const SearchServer& search_server, int term_id);
+
+        bool Contains(int ordinal);
+
+    private:
+        const SearchServer* search_server_;
+        int term_id_;
+        size_t segment_index_ = 0;
+        std::optional<IndexSegment::TermCursor> segment_cursor_;
+        const Posting* active_position_ = nullptr;
+        const Posting* active_end_ = nullptr;
     };
-    std::map<int, DocumentData> documents_;
-    std::map<std::string, std::map<int, double>> inverted_index_;
 
-    bool IsStopWord(const std::string& word) const;
+    bool IsStopWord(std::string_view word) const;
 
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+    std::pmr::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, std::pmr::memory_resource* resource) const;
 
-    static bool IsValidWord(const std::string& text);
-    static bool IsValidByMinus(const std::string& word);
+    static bool IsValidWord(std::string_view text);
+    static bool IsValidByMinus(std::string_view word);
+
+    std::vector<RejectedDocument> AddDocumentBatch(const std::vector<const NewDocument*>& documents);
+    static void SetDocumentTerms(DocumentData& document_data, std::vector<DocumentTerm> document_terms);
+    // Returns nullptr if there is no such document.
+    const DocumentData* FindDocument(int document_id) const;
+    // The document's term id of word, or -1 if the document does not have it.
+    int FindDocumentTermId(const DocumentData& document_data, std::string_view word) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
-    double CountIdf(const std::map<int, double>& inverted_index_id_tf) const;
+    static uint64_t NextEpoch();
+    double CountIdf(int term_id) const;
+    std::pmr::vector<double> CountPlusWordIdfs(const QueryPlusAndMinusWords& query_plus_and_minus_words, std::pmr::memory_resource* resource) const;
+
+    static TermKey MakeTermKey(std::string_view word);
+    int FindTermId(std::string_view word) const;
+    // Adds the word to the dictionary with a zero document frequency if it is new.
+    int FindOrAddTermId(std::string_view word);
+    // Returns nullptr for a term id out of range.
+    TermData* GetMutableTerm(int term_id);
+    // Term ids of the words, -1 for a word absent from the index.
+    std::pmr::vector<int> FindTermIds(const std::pmr::vector<std::string_view>& words, std::pmr::memory_resource* resource) const;
+    size_t SumDocumentFrequencies(const std::pmr::vector<int>& term_ids) const;
+    // Postings of a term with ordinals in [ordinal_begin, ordinal_end), in ordinal order.
+    template <typename PostingHandler>
+    void ForEachPosting(int term_id, int ordinal_begin, int ordinal_end, PostingHandler handle_posting) const;
+    void DecreaseDocumentFrequency(int term_id);
+    static void UpdateDocumentFrequency(TermData& term_data);
+    void UpdateDocumentCount();
 
+    std::vector<bool> GetRemovedOrdinals(int ordinal_begin, int ordinal_end) const;
+    void SealActiveSegment();
+    void StartMergeIfNeeded();
+    void InstallFinishedMerge(bool wait);
+    std::shared_ptr<const IndexSegment> MergeAllSegments(std::vector<std::shared_ptr<const IndexSegment>> segments) const;
+    void CompactOrdinalsIfNeeded();
+    void CompactOrdinals();
+
+    // Temporary data lives in the memory of resource, and so does the result.
+    template <typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, const std::pmr::vector<double>& plus_word_idfs, DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const;
+    std::pmr::vector<Document> FindAllDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, const std::pmr::vector<double>& plus_word_idfs, DocumentStatus status, std::pmr::memory_resource* resource) const;
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const QueryPlusAndMinusWords& query_plus_and_minus_words, const std::pmr::vector<double>& plus_word_idfs, DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const;
+    // Relevance of every document with a plus word, in ascending ordinal order.
+    std::pmr::vector<std::pair<int, double>> AccumulateRelevance(const QueryPlusAndMinusWords& query_plus_and_minus_words, const std::pmr::vector<double>& plus_word_idfs, std::pmr::memory_resource* resource) const;
+    // Bounds of the ordinal chunks of a parallel query: chunk i is [bounds[i], bounds[i + 1]).
+    std::vector<int> SplitOrdinals() const;
+    // Matched documents with ordinals in [ordinal_begin, ordinal_end), in ascending
+    // ordinal order.
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, DocumentPredicate document_predicate) const;
-    std::vector<Document> FindAllDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, DocumentStatus status) const;
+    std::vector<Document> FindOrdinalRangeDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, const std::pmr::vector<int>& plus_term_ids, const std::pmr::vector<double>& plus_word_idfs,
+        int ordinal_begin, int ordinal_end, size_t expected_candidate_count, DocumentPredicate document_predicate) const;
+    template <typename OrdinalRelevance, typename DocumentPredicate>
+    std::pmr::vector<Document> CollectDocuments(const OrdinalRelevance& ordinal_relevance, const std::pmr::vector<std::string_view>& minus_words, DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const;
+    std::pmr::vector<TermPostingCursor> CreateTermPostingCursors(const std::pmr::vector<std::string_view>& words, std::pmr::memory_resource* resource) const;
+    static bool ContainsAnyTerm(std::pmr::vector<TermPostingCursor>& term_posting_cursors, int ordinal);
+
+    void SelectTopDocuments(std::pmr::vector<Document>& matched_documents) const;
+};
+
+// Words come in the order of their term ids, the same for every document of a
+// server; find and count are binary searches over the forward index.
+class SearchServer::WordFrequencies {
+public:
+    using value_type = std::pair<std::string_view, double>;
+
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = WordFrequencies::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = value_type;
+
+        // The pair is built on dereference, so -> points into a temporary holding it.
+        struct ArrowProxy {
+            value_type value;
+
+            const value_type* operator->() const {
+                return &value;
+            }
+        };
+
+        Iterator() = default;
+
+        value_type operator*() const {
+            return { search_server_->terms_[static_cast<size_t>(term_->term_id)].word, term_->term_count / word_count_ };
+        }
+
+        ArrowProxy operator->() const {
+            return { **this };
+        }
+
+        Iterator& operator++() {
+            ++term_;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator iterator = *this;
+            ++term_;
+            return iterator;
+        }
+
+        friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+            return lhs.term_ == rhs.term_;
+        }
+
+        friend bool operator!=(const Iterator& lhs, const Iterator& rhs) {
+            return !(lhs == rhs);
+        }
+
+    private:
+        friend class WordFrequencies;
+
+        Iterator(const SearchServer* search_server, const DocumentTerm* term, double word_count)
+            : search_server_(search_server)
+            , term_(term)
+            , word_count_(word_count)
+        {
+        }
+
+        const SearchServer* search_server_ = nullptr;
+        const DocumentTerm* term_ = nullptr;
+        double word_count_ = 1.0;
+    };
+
+    WordFrequencies() = default;
+
+    Iterator begin() const {
+        return Iterator(search_server_, terms_, word_count_);
+    }
+
+    Iterator end() const {
+        return Iterator(search_server_, terms_ + term_count_, word_count_);
+    }
+
+    size_t size() const {
+        return term_count_;
+    }
+
+    bool empty() const {
+        return term_count_ == 0;
+    }
+
+    Iterator find(std::string_view word) const;
+
+    size_t count(std::string_view word) const {
+        return find(word) != end() ? 1 : 0;
+    }
+
+    // Compare the word sets of documents, ignoring frequencies. For documents of one
+    // server they hash and compare term ids without reading the words.
+    size_t HashWords() const;
+    bool HasSameWords(const WordFrequencies& other) const;
+
+    // Views of different servers are equal if they hold the same words with the same frequencies.
+    friend bool operator==(const WordFrequencies& lhs, const WordFrequencies& rhs);
+
+    friend bool operator!=(const WordFrequencies& lhs, const WordFrequencies& rhs) {
+        return !(lhs == rhs);
+    }
+
+private:
+    friend class SearchServer;
+
+    WordFrequencies(const SearchServer* search_server, const DocumentTerm* terms, size_t term_count, double word_count)
+        : search_server_(search_server)
+        , terms_(terms)
+        , term_count_(term_count)
+        , word_count_(word_count)
+    {
+    }
+
+    const SearchServer* search_server_ = nullptr;
+    const DocumentTerm* terms_ = nullptr;
+    size_t term_count_ = 0;
+    double word_count_ = 1.0;
 };
 
 template <typename StringContainer>
 SearchServer::SearchServer(const StringContainer& stop_words_container) {
-    for (const std::string& word : stop_words_container) {
+    std::set<std::string, std::less<>> stop_words;
+    for (const auto& word : stop_words_container) {
         if (!IsValidWord(word)) {
             throw std::invalid_argument("stop words include special characters"s);
         }
-        stop_words_.insert(word);
+        if (!std::string_view(word).empty()) {
+            stop_words.emplace(word);
+        }
     }
+    stop_words_ = std::make_shared<const std::set<std::string, std::less<>>>(std::move(stop_words));
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const {
-    QueryPlusAndMinusWords query_plus_and_minus_words = FindQueryPlusAndMinusWords(raw_query);
-    auto matched_documents = FindAllDocuments(query_plus_and_minus_words, document_predicate);
-    sort(matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            return (lhs.relevance > (EPSILON + rhs.relevance)) ||
-                (std::abs(lhs.relevance - rhs.relevance) < EPSILON && lhs.rating > rhs.rating);
+template <typename DocumentRange>
+std::vector<RejectedDocument> SearchServer::AddDocuments(const DocumentRange& documents) {
+    std::vector<const NewDocument*> batch;
+    for (const NewDocument& document : documents) {
+        batch.push_back(&document);
+    }
+    return AddDocumentBatch(batch);
+}
+
+// Only the document's own words are touched: the forward index in DocumentData lists
+// their term ids, and every word has its own document frequency, so the parallel
+// version updates distinct entries without locking. Shared chunks of the term table
+// are copied beforehand, so the parallel updates write only to chunks this server
+// owns. The postings themselves are dropped when their segment is sealed or merged.
+template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
+void SearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id) {
+    InstallFinishedMerge(false);
+    const int* ordinal = ordinals_by_id_.Find(document_id);
+    if (ordinal == nullptr) {
+        return;
+    }
+    DocumentData& document_data = documents_.GetMutable(static_cast<size_t>(*ordinal));
+    const DocumentTerm* terms_begin = document_data.terms.get();
+    const DocumentTerm* terms_end = terms_begin + document_data.term_count;
+    for (const DocumentTerm* document_term = terms_begin; document_term != terms_end; ++document_term) {
+        GetMutableTerm(document_term->term_id);
+    }
+    std::for_each(policy, terms_begin, terms_end,
+        [this](const DocumentTerm& document_term) {
+            DecreaseDocumentFrequency(document_term.term_id);
         });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    document_data = { REMOVED_DOCUMENT_ID, 0, DocumentStatus::REMOVED, 0, nullptr };
+    ordinals_by_id_.Erase(document_id);
+    UpdateDocumentCount();
+    epoch_ = NextEpoch();
+    CompactOrdinalsIfNeeded();
+}
+
+// Every query word is binary-searched in the document's forward index on its own, so
+// a parallel policy checks the words concurrently. Plus words come sorted and unique
+// from the query parser, and transform keeps their order.
+template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(ExecutionPolicy&& policy, std::string_view raw_query, int document_id) const {
+    QueryArenaScope query_arena;
+    const QueryPlusAndMinusWords query_plus_and_minus_words = FindQueryPlusAndMinusWords(raw_query, query_arena.GetResource());
+    const DocumentData* found_document_data = FindDocument(document_id);
+    if (found_document_data == nullptr) {
+        throw std::out_of_range("incorrect id"s);
     }
-    return matched_documents;
+    const DocumentData& document_data = *found_document_data;
+    const std::pmr::vector<std::string_view>& minus_words = query_plus_and_minus_words.minus_words;
+    const std::pmr::vector<std::string_view>& plus_words = query_plus_and_minus_words.plus_words;
+    if (std::any_of(policy, minus_words.begin(), minus_words.end(),
+        [this, &document_data](std::string_view word) {
+            return FindDocumentTermId(document_data, word) >= 0;
+        })) {
+        return { std::vector<std::string_view>(), document_data.document_status };
+    }
+    std::vector<std::string_view> matched_words(plus_words.size());
+    std::transform(policy, plus_words.begin(), plus_words.end(), matched_words.begin(),
+        [this, &document_data](std::string_view word) {
+            const int term_id = FindDocumentTermId(document_data, word);
+            return term_id < 0 ? std::string_view() : terms_[term_id].word;
+        });
+    matched_words.erase(std::remove(matched_words.begin(), matched_words.end(), std::string_view()), matched_words.end());
+    return { matched_words, document_data.document_status };
 }
 
+// Everything but the returned top documents is allocated in the thread's query arena.
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_id_relevance;
-    for (const std::string& word : query_plus_and_minus_words.plus_words) {
-        double query_word_idf = 0;
-        if (inverted_index_.count(word) != 0) {
-            std::map<int, double> inverted_index_id_tf = inverted_index_.at(word);
-            query_word_idf = CountIdf(inverted_index_id_tf);
-            for (const auto& [id, tf] : inverted_index_id_tf) {
-                document_id_relevance[id] += tf * query_word_idf;
-            }
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    PROFILE_QUERY();
+    QueryArenaScope query_arena;
+    const QueryPlusAndMinusWords query_plus_and_minus_words = FindQueryPlusAndMinusWords(raw_query, query_arena.GetResource());
+    return FindTopDocuments(query_plus_and_minus_words, CountPlusWordIdfs(query_plus_and_minus_words, query_arena.GetResource()), document_predicate);
+}
+
+// A parallel policy searches chunks of ordinals concurrently, so the predicate is
+// called from several threads at once; see FindAllDocuments.
+template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy>>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
+    PROFILE_QUERY();
+    QueryArenaScope query_arena;
+    const QueryPlusAndMinusWords query_plus_and_minus_words = FindQueryPlusAndMinusWords(raw_query, query_arena.GetResource());
+    std::pmr::vector<Document> matched_documents = FindAllDocuments(policy, query_plus_and_minus_words,
+        CountPlusWordIdfs(query_plus_and_minus_words, query_arena.GetResource()), document_predicate, query_arena.GetResource());
+    SelectTopDocuments(matched_documents);
+    return std::vector<Document>(matched_documents.begin(), matched_documents.end());
+}
+
+template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(policy, raw_query, [status](int id, DocumentStatus document_status, int average_document_rating) {
+        return status == document_status;
+        });
+}
+
+template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, const std::pmr::vector<double>& plus_word_idfs, DocumentPredicate document_predicate) const {
+    PROFILE_QUERY();
+    QueryArenaScope query_arena;
+    std::pmr::vector<Document> matched_documents = FindAllDocuments(query_plus_and_minus_words, plus_word_idfs, document_predicate, query_arena.GetResource());
+    SelectTopDocuments(matched_documents);
+    return std::vector<Document>(matched_documents.begin(), matched_documents.end());
+}
+
+template <typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, const std::pmr::vector<double>& plus_word_idfs, DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const {
+    return CollectDocuments(AccumulateRelevance(query_plus_and_minus_words, plus_word_idfs, resource), query_plus_and_minus_words.minus_words, document_predicate, resource);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const QueryPlusAndMinusWords& query_plus_and_minus_words, const std::pmr::vector<double>& plus_word_idfs, DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const {
+    if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        return FindAllDocuments(query_plus_and_minus_words, plus_word_idfs, document_predicate, resource);
+    }
+    else {
+        // The calling thread's arena cannot serve the workers, so only the chunk
+        // results live on the heap, one vector per chunk.
+        PROFILE_QUERY_STAGE(QueryStage::POSTINGS);
+        const std::pmr::vector<int> plus_term_ids = FindTermIds(query_plus_and_minus_words.plus_words, resource);
+        const size_t expected_candidate_count = SumDocumentFrequencies(plus_term_ids);
+        const std::vector<int> chunk_bounds = SplitOrdinals();
+        const int ordinal_count = chunk_bounds.back();
+        std::vector<std::vector<Document>> chunk_documents(chunk_bounds.size() - 1);
+        std::for_each(policy, chunk_documents.begin(), chunk_documents.end(), [&](std::vector<Document>& documents) {
+            const size_t chunk_index = static_cast<size_t>(&documents - chunk_documents.data());
+            const int ordinal_begin = chunk_bounds[chunk_index];
+            const int ordinal_end = chunk_bounds[chunk_index + 1];
+            const size_t chunk_candidate_count = ordinal_count == 0 ? 0
+                : static_cast<size_t>(static_cast<double>(expected_candidate_count) * (ordinal_end - ordinal_begin) / ordinal_count);
+            documents = FindOrdinalRangeDocuments(query_plus_and_minus_words, plus_term_ids, plus_word_idfs,
+                ordinal_begin, ordinal_end, chunk_candidate_count, document_predicate);
+            });
+        size_t matched_document_count = 0;
+        for (const std::vector<Document>& documents : chunk_documents) {
+            matched_document_count += documents.size();
+        }
+        std::pmr::vector<Document> matched_documents(resource);
+        matched_documents.reserve(matched_document_count);
+        for (const std::vector<Document>& documents : chunk_documents) {
+            matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
         }
+        return matched_documents;
     }
-    for (const std::string& word : query_plus_and_minus_words.minus_words) {
-        if (inverted_index_.count(word) != 0) {
-            std::map<int, double> inverted_index_id_tf = inverted_index_.at(word);
-            for (const auto& [id, tf] : inverted_index_id_tf) {
-                document_id_relevance.erase(id);
-            }
+}
+
+// Every chunk has its own accumulator and minus word cursors in the arena of the
+// thread that runs it. Each document still accumulates its relevance in query word
+// order, and chunks are concatenated in ordinal order, so the candidates and the top
+// documents selected from them match the sequential version exactly. Worker threads have no query of their own, so the
+// chunk is not profiled: the whole parallel scan counts as the POSTINGS stage.
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindOrdinalRangeDocuments(const QueryPlusAndMinusWords& query_plus_and_minus_words, const std::pmr::vector<int>& plus_term_ids, const std::pmr::vector<double>& plus_word_idfs,
+    int ordinal_begin, int ordinal_end, size_t expected_candidate_count, DocumentPredicate document_predicate) const {
+    QueryArenaScope query_arena;
+    RelevanceAccumulator ordinal_relevance(ordinal_begin, ordinal_end, expected_candidate_count, query_arena.GetResource());
+    for (size_t i = 0; i < plus_term_ids.size(); ++i) {
+        if (plus_term_ids[i] < 0) {
+            continue;
         }
+        const double query_word_idf = plus_word_idfs[i];
+        ForEachPosting(plus_term_ids[i], ordinal_begin, ordinal_end, [&ordinal_relevance, query_word_idf](const Posting& posting) {
+            ordinal_relevance.Add(posting.ordinal, posting.term_frequency * query_word_idf);
+            });
     }
+    std::pmr::vector<TermPostingCursor> minus_word_cursors = CreateTermPostingCursors(query_plus_and_minus_words.minus_words, query_arena.GetResource());
     std::vector<Document> matched_documents;
-    for (const auto& [id, relev] : document_id_relevance) {
-        if (document_predicate(id, documents_.at(id).document_status, documents_.at(id).average_document_rating)) {
-            matched_documents.push_back({ id, relev, documents_.at(id).average_document_rating });
+    matched_documents.reserve(ordinal_relevance.GetCandidateCount());
+    for (const auto& [ordinal, relevance] : ordinal_relevance.GetSortedCandidates()) {
+        const DocumentData& document_data = documents_[static_cast<size_t>(ordinal)];
+        const int id = document_data.id;
+        const bool has_minus_word = std::any_of(minus_word_cursors.begin(), minus_word_cursors.end(),
+            [ordinal = ordinal](TermPostingCursor& minus_word_cursor) {
+                return minus_word_cursor.Contains(ordinal);
+            });
+        if (id == REMOVED_DOCUMENT_ID || has_minus_word) {
+            continue;
+        }
+        if (document_predicate(id, document_data.document_status, document_data.average_document_rating)) {
+            matched_documents.push_back({ id, relevance, document_data.average_document_rating });
+        }
+    }
+    return matched_documents;
+}
+
+// Candidates come in ascending ordinal order, so minus words are excluded as a
+// galloping set difference against their postings instead of erasing every posting.
+template <typename OrdinalRelevance, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::CollectDocuments(const OrdinalRelevance& ordinal_relevance, const std::pmr::vector<std::string_view>& minus_words, DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const {
+    std::pmr::vector<TermPostingCursor> minus_word_cursors = CreateTermPostingCursors(minus_words, resource);
+    std::pmr::vector<Document> matched_documents(resource);
+    matched_documents.reserve(ordinal_relevance.size());
+    PROFILE_QUERY_COUNT(QueryCounter::CANDIDATES, ordinal_relevance.size());
+    for (const auto& [ordinal, relev] : ordinal_relevance) {
+        const DocumentData& document_data = documents_[static_cast<size_t>(ordinal)];
+        const int id = document_data.id;
+        if (id == REMOVED_DOCUMENT_ID || ContainsAnyTerm(minus_word_cursors, ordinal)) {
+            continue;
+        }
+        bool is_accepted = false;
+        {
+            PROFILE_QUERY_STAGE(QueryStage::PREDICATE);
+            is_accepted = document_predicate(id, document_data.document_status, document_data.average_document_rating);
+        }
+        PROFILE_QUERY_COUNT(QueryCounter::PREDICATE_REJECTIONS, is_accepted ? 0 : 1);
+        if (is_accepted) {
+            matched_documents.push_back({ id, relev, document_data.average_document_rating });
         }
     }
     return matched_documents;
+}
+
+// Every document lives in exactly one segment, so each document still accumulates
+// its relevance in query word order.
+template <typename PostingHandler>
+void SearchServer::ForEachPosting(int term_id, int ordinal_begin, int ordinal_end, PostingHandler handle_posting) const {
+    for (const std::shared_ptr<const IndexSegment>& segment : segments_) {
+        if (segment->GetOrdinalBegin() < ordinal_end && segment->GetOrdinalEnd() > ordinal_begin) {
+            segment->ForEachPosting(term_id, ordinal_begin, ordinal_end, handle_posting);
+        }
+    }
+    const auto active_it = active_postings_.find(term_id);
+    if (active_it == active_postings_.end() || ordinal_end <= active_ordinal_begin_) {
+        return;
+    }
+    const std::vector<Posting>& active_postings = active_it->second;
+    auto posting_it = std::lower_bound(active_postings.begin(), active_postings.end(), ordinal_begin,
+        [](const Posting& posting, int value) {
+            return posting.ordinal < value;
+        });
+    for (; posting_it != active_postings.end() && posting_it->ordinal < ordinal_end; ++posting_it) {
+        handle_posting(*posting_it);
+    }
 }
\ No newline at end of file
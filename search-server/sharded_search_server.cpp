@@ -0,0 +1,103 @@
+#include <cmath>
+
+#include "sharded_search_server.h"
+
+using namespace std;
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const SearchServer& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    if (document_id < 0) {
+        throw invalid_argument("incorrect id"s);
+    }
+    GetShard(document_id).AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    if (document_id >= 0) {
+        GetShard(document_id).RemoveDocument(document_id);
+    }
+}
+
+SearchServer::WordFrequencies ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    if (document_id < 0) {
+        return {};
+    }
+    return GetShard(document_id).GetWordFrequencies(document_id);
+}
+
+tuple<vector<string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    if (document_id < 0) {
+        throw out_of_range("incorrect id"s);
+    }
+    return GetShard(document_id).MatchDocument(raw_query, document_id);
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, [status](int id, DocumentStatus document_status, int average_document_rating) {
+        return status == document_status;
+        });
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+size_t ShardedSearchServer::GetMaxResultDocumentCount() const {
+    return max_result_document_count_;
+}
+
+void ShardedSearchServer::SetMaxResultDocumentCount(size_t max_result_document_count) {
+    max_result_document_count_ = max_result_document_count;
+    for (SearchServer& shard : shards_) {
+        shard.SetMaxResultDocumentCount(max_result_document_count);
+    }
+}
+
+SearchServer& ShardedSearchServer::GetShard(int document_id) {
+    return shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+const SearchServer& ShardedSearchServer::GetShard(int document_id) const {
+    return shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+// Computed the way a single server computes IDF from its own counts, so the
+// relevance of every document is the same bit for bit.
+pmr::vector<double> ShardedSearchServer::CountPlusWordIdfs(const SearchServer::QueryPlusAndMinusWords& query_plus_and_minus_words, pmr::memory_resource* resource) const {
+    const double log_document_count = log(static_cast<double>(GetDocumentCount()));
+    pmr::vector<double> plus_word_idfs(resource);
+    plus_word_idfs.reserve(query_plus_and_minus_words.plus_words.size());
+    for (const string_view word : query_plus_and_minus_words.plus_words) {
+        int document_frequency = 0;
+        for (const SearchServer& shard : shards_) {
+            document_frequency += shard.GetDocumentFrequency(word);
+        }
+        plus_word_idfs.push_back(document_frequency == 0 ? 0.0 : log_document_count - log(static_cast<double>(document_frequency)));
+    }
+    return plus_word_idfs;
+}
+
+// Every shard returns at most max_result_document_count_ documents, so the merged top
+// is taken from at most that many documents per shard.
+vector<Document> ShardedSearchServer::MergeTopDocuments(const vector<vector<Document>>& shard_documents) const {
+    vector<Document> matched_documents;
+    for (const vector<Document>& documents : shard_documents) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    const size_t top_count = min(max_result_document_count_, matched_documents.size());
+    partial_sort(matched_documents.begin(), matched_documents.begin() + static_cast<ptrdiff_t>(top_count), matched_documents.end(),
+        SearchServer::IsMoreRelevant);
+    matched_documents.resize(top_count);
+    return matched_documents;
+}
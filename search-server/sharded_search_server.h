@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <execution>
+#include <memory_resource>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "query_arena.h"
+#include "search_server.h"
+
+// Splits documents by id across several SearchServer shards. A query is parsed once,
+// every shard is searched in parallel with IDF computed from the document
+// frequencies of all shards, and the top documents of the shards are merged, so the
+// results are those of a single server holding every document.
+class ShardedSearchServer {
+public:
+    template <typename StopWords>
+    ShardedSearchServer(size_t shard_count, const StopWords& stop_words);
+
+    int GetDocumentCount() const;
+    size_t GetShardCount() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    SearchServer::WordFrequencies GetWordFrequencies(int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    // The shards are searched concurrently, so the predicate is called from several
+    // threads at once and must be safe to call that way.
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    size_t GetMaxResultDocumentCount() const;
+    void SetMaxResultDocumentCount(size_t max_result_document_count);
+
+private:
+    std::vector<SearchServer> shards_;
+    size_t max_result_document_count_ = MAX_RESULT_DOCUMENT_COUNT;
+
+    SearchServer& GetShard(int document_id);
+    const SearchServer& GetShard(int document_id) const;
+    std::pmr::vector<double> CountPlusWordIdfs(const SearchServer::QueryPlusAndMinusWords& query_plus_and_minus_words, std::pmr::memory_resource* resource) const;
+    std::vector<Document> MergeTopDocuments(const std::vector<std::vector<Document>>& shard_documents) const;
+};
+
+template <typename StopWords>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StopWords& stop_words) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("shard count must be positive"s);
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words);
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    // The shards only read the parsed query, so it can live in this thread's arena.
+    QueryArenaScope query_arena;
+    const SearchServer::QueryPlusAndMinusWords query_plus_and_minus_words = shards_.front().FindQueryPlusAndMinusWords(raw_query, query_arena.GetResource());
+    const std::pmr::vector<double> plus_word_idfs = CountPlusWordIdfs(query_plus_and_minus_words, query_arena.GetResource());
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    // Every shard thread calls the same document_predicate.
+    std::transform(std::execution::par, shards_.begin(), shards_.end(), shard_documents.begin(),
+        [&query_plus_and_minus_words, &plus_word_idfs, &document_predicate](const SearchServer& shard) {
+            return shard.FindTopDocuments(query_plus_and_minus_words, plus_word_idfs, document_predicate);
+        });
+    return MergeTopDocuments(shard_documents);
+}
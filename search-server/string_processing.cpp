@@ -1,23 +1,188 @@
+#include <cstdint>
+#include <cstring>
+
 #include "string_processing.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define SEARCH_SERVER_X86_SIMD
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define SEARCH_SERVER_X86_SIMD
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
 using namespace std;
 
-vector<string> SplitIntoWords(const string& text) {
-    vector<string> words;
-    string word;
-    for (const char c : text) {
-        if (c == ' ') {
-            if (!word.empty()) {
-                words.push_back(word);
-                word.clear();
-            }
+namespace {
+
+// The text is scanned in blocks of BLOCK_SIZE bytes. For every block the scanner
+// returns a bit mask of spaces and a bit mask of control characters, bit i
+// describing byte i of the block.
+const size_t BLOCK_SIZE = 32;
+
+struct BlockMasks {
+    uint32_t spaces;
+    uint32_t control_characters;
+};
+
+using BlockScanner = BlockMasks (*)(const char* block);
+
+[[maybe_unused]] BlockMasks ScanBlockScalar(const char* block) {
+    BlockMasks masks = { 0, 0 };
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        const unsigned char c = static_cast<unsigned char>(block[i]);
+        masks.spaces |= static_cast<uint32_t>(c == ' ') << i;
+        masks.control_characters |= static_cast<uint32_t>(c < ' ') << i;
+    }
+    return masks;
+}
+
+#ifdef SEARCH_SERVER_X86_SIMD
+
+BlockMasks ScanBlockSse2(const char* block) {
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i last_control_character = _mm_set1_epi8(' ' - 1);
+    BlockMasks masks = { 0, 0 };
+    for (size_t half = 0; half < 2; ++half) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + half * 16));
+        // Unsigned bytes <= 31 are the ones that are not changed by min(byte, 31).
+        const __m128i is_control_character = _mm_cmpeq_epi8(_mm_min_epu8(bytes, last_control_character), bytes);
+        const int shift = static_cast<int>(half * 16);
+        masks.spaces |= static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, spaces))) << shift;
+        masks.control_characters |= static_cast<uint32_t>(_mm_movemask_epi8(is_control_character)) << shift;
+    }
+    return masks;
+}
+
+#if defined(__GNUC__)
+__attribute__((target("avx2")))
+#endif
+BlockMasks ScanBlockAvx2(const char* block) {
+    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    const __m256i is_space = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+    const __m256i is_control_character = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, _mm256_set1_epi8(' ' - 1)), bytes);
+    return { static_cast<uint32_t>(_mm256_movemask_epi8(is_space)), static_cast<uint32_t>(_mm256_movemask_epi8(is_control_character)) };
+}
+
+bool IsAvx2Supported() {
+#if defined(__GNUC__)
+    return __builtin_cpu_supports("avx2");
+#else
+    int registers[4];
+    __cpuid(registers, 1);
+    const bool os_saves_avx_state = (registers[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(registers, 7, 0);
+    return os_saves_avx_state && (registers[1] & (1 << 5)) != 0;
+#endif
+}
+
+#endif
+
+BlockScanner ChooseBlockScanner() {
+#ifdef SEARCH_SERVER_X86_SIMD
+    return IsAvx2Supported() ? ScanBlockAvx2 : ScanBlockSse2;
+#else
+    return ScanBlockScalar;
+#endif
+}
+
+BlockScanner GetBlockScanner() {
+    static const BlockScanner block_scanner = ChooseBlockScanner();
+    return block_scanner;
+}
+
+int CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Calls the block scanner for every block of the text. The last incomplete block is
+// copied into a buffer padded with spaces, so the scanner never reads past the text.
+// Stops early and returns false if stop_on_control_character is set and a
+// control character is found.
+template <typename BlockHandler>
+bool ScanText(string_view text, bool stop_on_control_character, BlockHandler handle_block) {
+    const BlockScanner scan_block = GetBlockScanner();
+    char tail[BLOCK_SIZE];
+    for (size_t offset = 0; offset < text.size(); offset += BLOCK_SIZE) {
+        const char* block = text.data() + offset;
+        if (text.size() - offset < BLOCK_SIZE) {
+            memset(tail, ' ', BLOCK_SIZE);
+            memcpy(tail, block, text.size() - offset);
+            block = tail;
         }
-        else {
-            word += c;
+        const BlockMasks masks = scan_block(block);
+        if (stop_on_control_character && masks.control_characters != 0) {
+            return false;
+        }
+        handle_block(offset, masks.spaces);
+    }
+    return true;
+}
+
+template <typename Words>
+bool SplitText(string_view text, bool stop_on_control_character, Words& words) {
+    size_t word_begin = 0;
+    // Bit 0 tells whether the byte before the current block is a space; the text
+    // is treated as if it were preceded by one.
+    uint32_t previous_is_space = 1;
+    const bool is_valid = ScanText(text, stop_on_control_character, [&](size_t offset, uint32_t spaces) {
+        const uint32_t after_space = (spaces << 1) | previous_is_space;
+        const uint32_t word_begins = ~spaces & after_space;
+        const uint32_t word_ends = spaces & ~after_space;
+        uint32_t boundaries = word_begins | word_ends;
+        while (boundaries != 0) {
+            const int bit = CountTrailingZeros(boundaries);
+            const size_t position = offset + static_cast<size_t>(bit);
+            if (word_begins & (1u << bit)) {
+                word_begin = position;
+            }
+            else {
+                words.push_back(text.substr(word_begin, position - word_begin));
+            }
+            boundaries &= boundaries - 1;
         }
+        previous_is_space = spaces >> (BLOCK_SIZE - 1);
+    });
+    if (!is_valid) {
+        return false;
+    }
+    if (previous_is_space == 0) {
+        words.push_back(text.substr(word_begin));
     }
-    if (!word.empty()) {
-        words.push_back(word);
+    return true;
+}
+
+}
+
+vector<string_view> SplitIntoWords(string_view text) {
+    vector<string_view> words;
+    SplitText(text, false, words);
+    return words;
+}
+
+optional<vector<string_view>> SplitIntoValidWords(string_view text) {
+    vector<string_view> words;
+    if (!SplitText(text, true, words)) {
+        return nullopt;
     }
     return words;
-}
\ No newline at end of file
+}
+
+optional<pmr::vector<string_view>> SplitIntoValidWords(string_view text, pmr::memory_resource* resource) {
+    pmr::vector<string_view> words(resource);
+    if (!SplitText(text, true, words)) {
+        return nullopt;
+    }
+    return words;
+}
+
+bool ContainsControlCharacters(string_view text) {
+    return !ScanText(text, true, [](size_t, uint32_t) {});
+}
@@ -1,6 +1,15 @@
 #pragma once
 
-#include <string>
+#include <memory_resource>
+#include <optional>
+#include <string_view>
 #include <vector>
 
-std::vector<std::string> SplitIntoWords(const std::string& text);
+std::vector<std::string_view> SplitIntoWords(std::string_view text);
+
+// Splits text by spaces and checks it for control characters (codes 0-31) in the same pass.
+// Returns std::nullopt if the text contains a control character.
+std::optional<std::vector<std::string_view>> SplitIntoValidWords(std::string_view text);
+std::optional<std::pmr::vector<std::string_view>> SplitIntoValidWords(std::string_view text, std::pmr::memory_resource* resource);
+
+bool ContainsControlCharacters(std::string_view text);
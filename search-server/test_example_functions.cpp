@@ -1,8 +1,30 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <execution>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
+#include "concurrent_request_queue.h"
+#include "process_queries.h"
+#include "query_profile.h"
+#include "read_input_functions.h"
+#include "relevance_accumulator.h"
+#include "remove_duplicates.h"
+#include "request_queue.h"
 #include "search_server.h"
+#include "sharded_search_server.h"
 #include "test_example_functions.h"
+#include "versioned_search_server.h"
 
 using namespace std;
 
@@ -58,6 +80,23 @@ void AssertHint(const A& a, const string& hint) {
 #define ASSERT_HINT(a, hint) AssertHint(a, hint)
 #define RUN_TEST(func) RunTestImpl(func, #func)
 
+namespace {
+
+const vector<string> TEST_VOCABULARY = { "cat"s, "dog"s, "bird"s, "fish"s, "curly"s, "fancy"s, "big"s, "small"s, "tail"s, "collar"s, "and"s };
+
+//   word_count  TEST_VOCABULARY,    ;    seed
+string MakeTestText(int seed, int word_count) {
+    string text;
+    uint32_t state = static_cast<uint32_t>(seed);
+    for (int i = 0; i < word_count; ++i) {
+        state = state * 1103515245u + 12345u;
+        text += TEST_VOCABULARY[(state >> 16) % TEST_VOCABULARY.size()] + " "s;
+    }
+    return text;
+}
+
+}
+
 //  ,     -   
 void TestExcludeStopWordsFromAddedDocumentContent() {
     const int doc_id = 42;
@@ -190,6 +229,1049 @@ void TestCalculateRelevance() {
         "Relevance is incorrect"s);
 }
 
+//     : - , -  
+void TestMatchDocument() {
+    SearchServer server("and in"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::BANNED, { 1, 2, 3 });
+    {
+        const auto [words, status] = server.MatchDocument("curly tail dog"s, 1);
+        const vector<string_view> expected = { "curly"sv, "tail"sv };
+        ASSERT_HINT(words == expected, "Matched words must contain every plus-word from the document"s);
+        ASSERT(status == DocumentStatus::ACTUAL);
+    }
+    {
+        const auto [words, status] = server.MatchDocument("curly -collar"s, 2);
+        ASSERT_HINT(words.empty(), "Minus-word in the document must clear matched words"s);
+        ASSERT(status == DocumentStatus::BANNED);
+    }
+}
+
+//     ,     id
+void TestAddDocumentsInAnyIdOrder() {
+    SearchServer server;
+    server.AddDocument(5, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(1, "black cat"s, DocumentStatus::ACTUAL, { 2 });
+    server.AddDocument(3, "grey cat"s, DocumentStatus::ACTUAL, { 3 });
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), 3u);
+    for (const int id : { 1, 3, 5 }) {
+        const auto [words, status] = server.MatchDocument("cat"s, id);
+        ASSERT_EQUAL_HINT(words.size(), 1u, "Each document must match its own words"s);
+    }
+    const auto [words, status] = server.MatchDocument("black"s, 3);
+    ASSERT(words.empty());
+}
+
+// ,       ,   
+void TestParallelFindTopDocuments() {
+    SearchServer server("and with"s);
+    const vector<string> texts = { "white cat and yellow hat"s, "curly cat curly tail"s, "nasty dog with big eyes"s,
+        "nasty pigeon john"s, "funny pet and nasty rat"s, "funny pet with curly hair"s, "big dog cat"s };
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        server.AddDocument(id, texts[id], id % 3 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id, 2 });
+    }
+    for (const string& query : { "curly nasty cat"s, "big dog -john"s, "funny pet -curly"s, "hat"s }) {
+        const auto sequential = server.FindTopDocuments(query);
+        const auto parallel = server.FindTopDocuments(execution::par, query);
+        ASSERT_EQUAL_HINT(parallel.size(), sequential.size(), "Parallel search must find the same documents"s);
+        for (size_t i = 0; i < sequential.size(); ++i) {
+            ASSERT_EQUAL(parallel[i].id, sequential[i].id);
+            ASSERT_EQUAL(parallel[i].relevance, sequential[i].relevance);
+            ASSERT_EQUAL(parallel[i].rating, sequential[i].rating);
+        }
+        ASSERT_EQUAL(server.FindTopDocuments(execution::seq, query, DocumentStatus::BANNED).size(),
+            server.FindTopDocuments(execution::par, query, DocumentStatus::BANNED).size());
+    }
+
+    //    ,    -   
+    SearchServer chunked_server;
+    const int document_count = 3 * PARALLEL_QUERY_MIN_CHUNK_ORDINAL_COUNT + 100;
+    const vector<string> words = { "cat"s, "dog"s, "bird"s, "fish"s, "rat"s };
+    for (int id = 0; id < document_count; ++id) {
+        string text;
+        for (int i = 0; i < 5; ++i) {
+            text += words[static_cast<size_t>((id * (i + 3) + id / 7) % 5)] + " "s;
+        }
+        chunked_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 11 });
+    }
+    for (int id = 0; id < document_count; id += 13) {
+        chunked_server.RemoveDocument(id);
+    }
+    for (const size_t max_result_document_count : { static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT), static_cast<size_t>(document_count) }) {
+        chunked_server.SetMaxResultDocumentCount(max_result_document_count);
+        for (const string& query : { "cat dog"s, "fish -bird"s, "rat cat -dog -fish"s }) {
+            const auto sequential = chunked_server.FindTopDocuments(query, [](int id, DocumentStatus status, int rating) {
+                return rating != 3;
+                });
+            const auto parallel = chunked_server.FindTopDocuments(execution::par, query, [](int id, DocumentStatus status, int rating) {
+                return rating != 3;
+                });
+            ASSERT(!sequential.empty());
+            ASSERT_EQUAL_HINT(parallel.size(), sequential.size(), "Chunked parallel search must find the same documents"s);
+            for (size_t i = 0; i < sequential.size(); ++i) {
+                ASSERT_EQUAL_HINT(parallel[i].id, sequential[i].id, "Documents of equal relevance must come in the same order"s);
+                ASSERT_EQUAL(parallel[i].relevance, sequential[i].relevance);
+            }
+        }
+    }
+}
+
+//          
+void TestProcessQueries() {
+    SearchServer server("and with"s);
+    const vector<string> texts = { "funny pet and nasty rat"s, "funny pet with curly hair"s, "funny pet and not very nasty rat"s,
+        "pet with rat and rat and rat"s, "nasty rat with curly hair"s };
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        server.AddDocument(id + 1, texts[id], DocumentStatus::ACTUAL, { 1, 2 });
+    }
+    const vector<string> queries = { "nasty rat -not"s, "not very funny nasty pet"s, "curly hair"s, "missing"s };
+    const auto results = ProcessQueries(server, queries);
+    ASSERT_EQUAL(results.size(), queries.size());
+    vector<int> expected_ids;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto documents = server.FindTopDocuments(queries[i]);
+        ASSERT_EQUAL_HINT(results[i].size(), documents.size(), "Batch results must follow the order of queries"s);
+        for (const Document& document : documents) {
+            expected_ids.push_back(document.id);
+        }
+    }
+    const JoinedDocuments joined = ProcessQueriesJoined(server, queries);
+    ASSERT_EQUAL(joined.size(), expected_ids.size());
+    vector<int> joined_ids;
+    for (const Document& document : joined) {
+        joined_ids.push_back(document.id);
+    }
+    ASSERT_HINT(joined_ids == expected_ids, "Joined results must list documents of every query in order"s);
+}
+
+//       
+void TestMaxResultDocumentCount() {
+    SearchServer server;
+    for (int id = 0; id < 20; ++id) {
+        server.AddDocument(id, "cat"s + string(static_cast<size_t>(id % 4), 's') + " cat"s, DocumentStatus::ACTUAL, { id });
+    }
+    ASSERT_EQUAL(server.GetMaxResultDocumentCount(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    server.SetMaxResultDocumentCount(8);
+    const auto found_docs = server.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(found_docs.size(), 8u);
+    for (size_t i = 1; i < found_docs.size(); ++i) {
+        ASSERT_HINT(found_docs[i - 1].relevance > found_docs[i].relevance - EPSILON, "Documents must be sorted by relevance"s);
+        ASSERT_HINT(found_docs[i - 1].rating >= found_docs[i].rating || found_docs[i - 1].relevance > found_docs[i].relevance + EPSILON,
+            "Documents with equal relevance must be sorted by rating"s);
+    }
+    ASSERT_EQUAL(found_docs[0].id, 19);
+    ASSERT_EQUAL(server.FindTopDocuments(execution::par, "cat"s).size(), 8u);
+}
+
+//       
+void TestRemoveDocument() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "curly cat and curly tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
+    server.AddDocument(3, "big cat fancy collar"s, DocumentStatus::ACTUAL, { 1, 2, 8 });
+    const SearchServer::WordFrequencies word_frequencies = server.GetWordFrequencies(1);
+    ASSERT_EQUAL(word_frequencies.size(), 3u);
+    ASSERT_HINT(abs(word_frequencies.find("curly"sv)->second - 0.5) < EPSILON, "Word frequency is incorrect"s);
+    ASSERT_HINT(word_frequencies.find("curly"sv)->first.data() == get<0>(server.MatchDocument("curly"s, 1))[0].data(),
+        "Word frequencies must refer to the index words, not to copies"s);
+    ASSERT_EQUAL(word_frequencies.count("and"sv), 0u);
+    ASSERT(word_frequencies.find("dog"sv) == word_frequencies.end());
+    ASSERT(word_frequencies == server.GetWordFrequencies(1));
+    ASSERT(word_frequencies != server.GetWordFrequencies(2));
+    ASSERT(server.GetWordFrequencies(42).empty());
+
+    server.RemoveDocument(1);
+    ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    ASSERT(server.GetWordFrequencies(1).empty());
+    ASSERT_HINT(server.FindTopDocuments("tail"s).empty(), "Removed document must not be found"s);
+    const auto found_docs = server.FindTopDocuments("curly cat"s);
+    ASSERT_EQUAL(found_docs.size(), 2u);
+
+    server.RemoveDocument(execution::par, 3);
+    server.RemoveDocument(42);
+    ASSERT_EQUAL(server.GetDocumentCount(), 1);
+    ASSERT(vector<int>(server.begin(), server.end()) == vector<int>{ 2 });
+    ASSERT(server.FindTopDocuments("cat"s).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("fancy"s).size(), 1u);
+}
+
+//       
+void TestRemoveDuplicates() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, { 1, 2 });
+    server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    const vector<int> removed = RemoveDuplicates(server);
+    ASSERT_HINT((removed == vector<int>{ 3, 4, 5, 7 }), "Duplicates with greater ids must be removed"s);
+    ASSERT_EQUAL(server.GetDocumentCount(), 5);
+    ASSERT_HINT(RemoveDuplicates(server).empty(), "Server without duplicates must stay unchanged"s);
+    server.AddDocument(0, "curly hair with nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    ASSERT_HINT((RemoveDuplicates(server) == vector<int>{ 9 }), "The duplicate with the greater id must be removed even if it was added first"s);
+}
+
+//            
+void TestRejectControlCharacters() {
+    SearchServer server;
+    const string long_text = "  the quick  brown fox jumps over the lazy dog and keeps running far away   "s;
+    server.AddDocument(1, long_text, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(server.GetWordFrequencies(1).size(), 13u);
+    ASSERT_EQUAL(server.FindTopDocuments("away"s).size(), 1u);
+    bool is_rejected = false;
+    try {
+        server.AddDocument(2, long_text + "sky\x12"s, DocumentStatus::ACTUAL, { 1 });
+    }
+    catch (const invalid_argument&) {
+        is_rejected = true;
+    }
+    ASSERT_HINT(is_rejected, "Documents with control characters must be rejected"s);
+    ASSERT_EQUAL(server.GetDocumentCount(), 1);
+}
+
+//   IDF     
+void TestIdfFollowsDocumentCount() {
+    SearchServer server;
+    server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(2, "cat"s, DocumentStatus::ACTUAL, { 2 });
+    server.AddDocument(3, "bird"s, DocumentStatus::ACTUAL, { 3 });
+    ASSERT_HINT(abs(server.FindTopDocuments("cat"s)[0].relevance - log(3.0 / 2.0)) < EPSILON, "IDF must use the current document count"s);
+    server.RemoveDocument(3);
+    ASSERT_HINT(abs(server.FindTopDocuments("cat"s)[0].relevance) < EPSILON, "IDF must be updated after removal"s);
+    server.RemoveDocument(2);
+    server.AddDocument(4, "bird"s, DocumentStatus::ACTUAL, { 3 });
+    server.AddDocument(5, "fish"s, DocumentStatus::ACTUAL, { 3 });
+    ASSERT_HINT(abs(server.FindTopDocuments("cat"s)[0].relevance - log(3.0) / 2.0) < EPSILON, "IDF must be updated after addition"s);
+}
+
+// ,          
+void TestVersionedSearchServer() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "curly cat and curly tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    VersionedSearchServer versioned_server(move(search_server));
+    RequestQueue request_queue(versioned_server);
+    const shared_ptr<const SearchServer> snapshot = versioned_server.GetSnapshot();
+    versioned_server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
+    versioned_server.RemoveDocument(1);
+    ASSERT_HINT(snapshot->FindTopDocuments("curly"s).size() == 1u && snapshot->FindTopDocuments("curly"s)[0].id == 1,
+        "Snapshot must not see later changes"s);
+    const auto found_docs = versioned_server.GetSnapshot()->FindTopDocuments("curly"s);
+    ASSERT_EQUAL(found_docs.size(), 1u);
+    ASSERT_EQUAL(found_docs[0].id, 2);
+    ASSERT_EQUAL(request_queue.AddFindRequest("collar"s).size(), 1u);
+    ASSERT(request_queue.AddFindRequest("tail"s).empty());
+    versioned_server.Update([](SearchServer& server) {
+        server.AddDocument(3, "big cat fancy collar"s, DocumentStatus::ACTUAL, { 1, 2, 8 });
+        server.AddDocument(4, "big dog sparrow"s, DocumentStatus::ACTUAL, { 1, 3, 2 });
+    });
+    ASSERT_EQUAL(versioned_server.GetSnapshot()->GetDocumentCount(), 3);
+    ASSERT_EQUAL(snapshot->GetWordFrequencies(1).size(), 3u);
+}
+
+//           
+void TestSegmentedIndex() {
+    const int document_count = 3 * ACTIVE_SEGMENT_DOCUMENT_COUNT + 100;
+    SearchServer server;
+    SearchServer expected_server;
+    for (int id = 0; id < document_count; ++id) {
+        server.AddDocument(id, MakeTestText(id, 4), DocumentStatus::ACTUAL, { id % 10 });
+    }
+    for (int id = 0; id < document_count; id += 7) {
+        server.RemoveDocument(id);
+        if (id % 2 == 0) {
+            server.AddDocument(id, MakeTestText(id + document_count, 4), DocumentStatus::ACTUAL, { id % 10 });
+        }
+    }
+    for (int id = 0; id < document_count; ++id) {
+        if (id % 7 != 0) {
+            expected_server.AddDocument(id, MakeTestText(id, 4), DocumentStatus::ACTUAL, { id % 10 });
+        }
+        else if (id % 2 == 0) {
+            expected_server.AddDocument(id, MakeTestText(id + document_count, 4), DocumentStatus::ACTUAL, { id % 10 });
+        }
+    }
+    server.SetMaxResultDocumentCount(static_cast<size_t>(document_count));
+    expected_server.SetMaxResultDocumentCount(static_cast<size_t>(document_count));
+    const auto by_id = [](const Document& lhs, const Document& rhs) {
+        return lhs.id < rhs.id;
+    };
+    for (int pass = 0; pass < 2; ++pass) {
+        ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+        for (const string& query : { "curly cat"s, "big fish -dog"s, "tail collar -small -fancy"s }) {
+            auto found_docs = server.FindTopDocuments(query);
+            auto expected_docs = expected_server.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(found_docs.size(), expected_docs.size(), "Segments must return every matching document once"s);
+            sort(found_docs.begin(), found_docs.end(), by_id);
+            sort(expected_docs.begin(), expected_docs.end(), by_id);
+            for (size_t i = 0; i < found_docs.size(); ++i) {
+                ASSERT_EQUAL(found_docs[i].id, expected_docs[i].id);
+                ASSERT(abs(found_docs[i].relevance - expected_docs[i].relevance) < EPSILON);
+            }
+        }
+        for (const int id : { 1, 14, 700, document_count - 1 }) {
+            ASSERT(get<0>(server.MatchDocument("cat dog bird fish"s, id)) == get<0>(expected_server.MatchDocument("cat dog bird fish"s, id)));
+        }
+        server.MergeSegments();
+    }
+}
+
+//            
+void TestSaveAndOpen() {
+    const string path = (filesystem::temp_directory_path() / "search_server_test.index"s).string();
+    const int document_count = ACTIVE_SEGMENT_DOCUMENT_COUNT + 100;
+    SearchServer server("and in"s);
+    for (int id = 0; id < document_count; ++id) {
+        server.AddDocument(id, MakeTestText(id, 4), id % 3 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id % 10, 1 });
+    }
+    for (int id = 0; id < document_count; id += 5) {
+        server.RemoveDocument(id);
+    }
+    server.Save(path);
+    const SearchServer opened_server = SearchServer::Open(path);
+    server.SetMaxResultDocumentCount(static_cast<size_t>(document_count));
+    SearchServer reopened_server = opened_server;
+    reopened_server.SetMaxResultDocumentCount(static_cast<size_t>(document_count));
+
+    ASSERT_EQUAL(reopened_server.GetDocumentCount(), server.GetDocumentCount());
+    ASSERT(equal(reopened_server.begin(), reopened_server.end(), server.begin(), server.end()));
+    for (const string& query : { "curly cat"s, "big fish -dog and"s, "tail collar -small -fancy"s }) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const auto found_docs = reopened_server.FindTopDocuments(query, status);
+            const auto expected_docs = server.FindTopDocuments(query, status);
+            ASSERT_EQUAL_HINT(found_docs.size(), expected_docs.size(), "Opened index must find the same documents"s);
+            for (size_t i = 0; i < found_docs.size(); ++i) {
+                ASSERT_EQUAL(found_docs[i].id, expected_docs[i].id);
+                ASSERT_EQUAL(found_docs[i].rating, expected_docs[i].rating);
+                ASSERT(abs(found_docs[i].relevance - expected_docs[i].relevance) < EPSILON);
+            }
+        }
+    }
+    for (const int id : { 1, 2, 3, document_count - 2 }) {
+        ASSERT(get<0>(reopened_server.MatchDocument("cat dog bird fish"s, id)) == get<0>(server.MatchDocument("cat dog bird fish"s, id)));
+        ASSERT(reopened_server.GetWordFrequencies(id) == server.GetWordFrequencies(id));
+    }
+    ASSERT_HINT(reopened_server.GetWordFrequencies(1).count("and"s) == 0, "Stop words must be restored"s);
+
+    reopened_server.AddDocument(document_count, "curly parrot"s, DocumentStatus::ACTUAL, { 9 });
+    reopened_server.RemoveDocument(1);
+    ASSERT_EQUAL(reopened_server.FindTopDocuments("parrot"s).size(), 1u);
+    ASSERT_EQUAL(opened_server.FindTopDocuments("parrot"s).size(), 0u);
+    ASSERT_EQUAL(opened_server.GetDocumentCount(), server.GetDocumentCount());
+
+    const string all_words_query = "cat dog bird fish curly fancy big small tail collar"s;
+    const size_t opened_found_count = opened_server.FindTopDocuments(all_words_query).size();
+    reopened_server.Save(path);
+    ASSERT_EQUAL_HINT(opened_server.FindTopDocuments(all_words_query).size(), opened_found_count,
+        "Saving over the opened file must not change the servers that map it"s);
+    ASSERT(get<0>(opened_server.MatchDocument(all_words_query, 1)) == get<0>(server.MatchDocument(all_words_query, 1)));
+    const SearchServer resaved_server = SearchServer::Open(path);
+    ASSERT_EQUAL(resaved_server.GetDocumentCount(), reopened_server.GetDocumentCount());
+    ASSERT_EQUAL(resaved_server.FindTopDocuments("parrot"s).size(), 1u);
+
+    {
+        ofstream output(path, ios::binary | ios::trunc);
+        output << "not an index"s;
+    }
+    try {
+        SearchServer::Open(path);
+        ASSERT_HINT(false, "Opening a file that is not an index must throw"s);
+    }
+    catch (const runtime_error&) {
+    }
+    filesystem::remove(path);
+}
+
+// ,         ,    
+void TestCompressedPostings() {
+    SearchServer server;
+    const int document_count = 2 * ACTIVE_SEGMENT_DOCUMENT_COUNT;
+    string repeated_words;
+    for (int i = 0; i < 300; ++i) {
+        repeated_words += "cat "s;
+    }
+    for (int id = 0; id < document_count; ++id) {
+        if (id == 1000) {
+            server.AddDocument(id, repeated_words + "rare dog"s, DocumentStatus::ACTUAL, { 1 });
+        }
+        else {
+            server.AddDocument(id, id % 500 == 0 ? "rare bird"s : "dog bird"s, DocumentStatus::ACTUAL, { 1 });
+        }
+    }
+    server.MergeSegments();
+    const double document_count_log = log(static_cast<double>(document_count));
+    const vector<Document> cat_docs = server.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(cat_docs.size(), 1u);
+    ASSERT(abs(cat_docs[0].relevance - 300.0 / 302.0 * document_count_log) < EPSILON);
+    server.SetMaxResultDocumentCount(static_cast<size_t>(document_count));
+    const vector<Document> rare_docs = server.FindTopDocuments("rare"s);
+    ASSERT_EQUAL_HINT(rare_docs.size(), static_cast<size_t>(document_count / 500 + 1), "Every block of a long posting list must be decoded"s);
+    for (const int id : { 0, 500, 1000, 8000 }) {
+        ASSERT_EQUAL(get<0>(server.MatchDocument("rare cat"s, id)).size(), id == 1000 ? 2u : 1u);
+    }
+    ASSERT(get<0>(server.MatchDocument("rare"s, 501)).empty());
+}
+
+//     -,        
+void TestMinusWordsAcrossBlocks() {
+    SearchServer server;
+    const int document_count = 2 * ACTIVE_SEGMENT_DOCUMENT_COUNT + 500;
+    for (int id = 0; id < document_count; ++id) {
+        string text = "cat"s;
+        if (id % 3 == 0) {
+            text += " dog"s;
+        }
+        if (id % 1000 == 7) {
+            text += " bird"s;
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, { 1 });
+    }
+    server.SetMaxResultDocumentCount(static_cast<size_t>(document_count));
+    for (const bool merged : { false, true }) {
+        if (merged) {
+            server.MergeSegments();
+        }
+        const vector<Document> found_docs = server.FindTopDocuments("cat -dog -bird"s);
+        const vector<Document> parallel_found_docs = server.FindTopDocuments(execution::par, "cat -dog -bird"s);
+        int expected_count = 0;
+        for (int id = 0; id < document_count; ++id) {
+            expected_count += id % 3 != 0 && id % 1000 != 7 ? 1 : 0;
+        }
+        ASSERT_EQUAL(found_docs.size(), static_cast<size_t>(expected_count));
+        ASSERT_EQUAL(parallel_found_docs.size(), static_cast<size_t>(expected_count));
+        for (const Document& document : found_docs) {
+            ASSERT_HINT(document.id % 3 != 0 && document.id % 1000 != 7, "Documents with minus words must be excluded"s);
+        }
+        ASSERT(get<0>(server.MatchDocument("cat -bird"s, 1007)).empty());
+        ASSERT_EQUAL(get<0>(server.MatchDocument("cat dog bird"s, 3007)).size(), 2u);
+    }
+}
+
+// ,    MatchDocument    ,   ,      
+void TestParallelMatchDocument() {
+    SearchServer server("and in"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::BANNED, { 1, 2, 3 });
+    string long_query;
+    for (int i = 0; i < 300; ++i) {
+        long_query += "word"s + to_string(i) + " "s;
+    }
+    long_query += "tail collar curly tail"s;
+    for (const int id : { 1, 2 }) {
+        const auto [words, status] = server.MatchDocument(execution::par, long_query, id);
+        const auto [expected_words, expected_status] = server.MatchDocument(long_query, id);
+        ASSERT(words == expected_words);
+        ASSERT(status == expected_status);
+    }
+    const auto [words, status] = server.MatchDocument(execution::par, long_query, 1);
+    const vector<string_view> expected = { "curly"sv, "tail"sv };
+    ASSERT_HINT(words == expected, "Matched words must be sorted and unique"s);
+    ASSERT_HINT(words[0].data() == server.GetWordFrequencies(1).find("curly"sv)->first.data(), "Matched words must refer to the index words"s);
+    ASSERT(get<0>(server.MatchDocument(execution::par, "curly -fancy"s, 2)).empty());
+    ASSERT(get<0>(server.MatchDocument(execution::seq, "curly -fancy"s, 2)).empty());
+}
+
+//            
+void TestQueryResultCache() {
+    SearchServer server("and in"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
+    RequestQueue request_queue(server, 2);
+    ASSERT_EQUAL(request_queue.AddFindRequest("curly -collar"s).size(), 1u);
+    ASSERT_EQUAL_HINT(request_queue.AddFindRequest("-collar curly and curly"s).size(), 1u, "Equal parsed queries must share a cache entry"s);
+    ASSERT_EQUAL(request_queue.GetCacheHits(), 1u);
+    ASSERT_EQUAL(request_queue.GetCacheMisses(), 1u);
+    ASSERT(request_queue.AddFindRequest("curly"s, DocumentStatus::BANNED).empty());
+    ASSERT_EQUAL_HINT(request_queue.GetCacheMisses(), 2u, "Status must be a part of the cache key"s);
+    request_queue.AddFindRequest("dog"s);
+    request_queue.AddFindRequest("curly -collar"s);
+    ASSERT_EQUAL_HINT(request_queue.GetCacheMisses(), 4u, "The least recently used query must be evicted"s);
+    request_queue.AddFindRequest("dog"s);
+    ASSERT_EQUAL(request_queue.GetCacheHits(), 2u);
+
+    server.AddDocument(3, "curly parrot"s, DocumentStatus::ACTUAL, { 5 });
+    ASSERT_EQUAL_HINT(request_queue.AddFindRequest("curly -collar"s).size(), 2u, "Adding a document must invalidate the cache"s);
+    server.RemoveDocument(1);
+    ASSERT_EQUAL_HINT(request_queue.AddFindRequest("curly -collar"s).size(), 1u, "Removing a document must invalidate the cache"s);
+    ASSERT_EQUAL(request_queue.GetCacheMisses(), 6u);
+    request_queue.AddFindRequest("curly"s, [](int id, DocumentStatus status, int rating) {
+        return rating > 0;
+        });
+    ASSERT_EQUAL_HINT(request_queue.GetCacheHits() + request_queue.GetCacheMisses(), 8u, "Predicate queries must bypass the cache"s);
+}
+
+// ,             ,    
+void TestShardedSearchServer() {
+    SearchServer server("and"s);
+    ShardedSearchServer sharded_server(4, "and"s);
+    for (int id = 0; id < 3000; ++id) {
+        const DocumentStatus status = id % 4 == 1 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        server.AddDocument(id, MakeTestText(id, 5), status, { id % 7, id % 3 });
+        sharded_server.AddDocument(id, MakeTestText(id, 5), status, { id % 7, id % 3 });
+    }
+    for (int id = 0; id < 3000; id += 11) {
+        server.RemoveDocument(id);
+        sharded_server.RemoveDocument(id);
+    }
+    ASSERT_EQUAL(sharded_server.GetDocumentCount(), server.GetDocumentCount());
+    for (const size_t max_result_document_count : { 5u, 3000u }) {
+        server.SetMaxResultDocumentCount(max_result_document_count);
+        sharded_server.SetMaxResultDocumentCount(max_result_document_count);
+        for (const string& query : { "curly cat"s, "big fish -dog and"s, "tail collar -small -fancy"s }) {
+            const auto found_docs = sharded_server.FindTopDocuments(query);
+            const auto expected_docs = server.FindTopDocuments(query);
+            ASSERT_EQUAL(found_docs.size(), expected_docs.size());
+            for (size_t i = 0; i < found_docs.size(); ++i) {
+                ASSERT_HINT(abs(found_docs[i].relevance - expected_docs[i].relevance) < EPSILON, "Shards must rank with global IDF"s);
+                ASSERT_EQUAL(found_docs[i].rating, expected_docs[i].rating);
+            }
+        }
+        ASSERT_EQUAL(sharded_server.FindTopDocuments("cat"s, DocumentStatus::BANNED).size(), server.FindTopDocuments("cat"s, DocumentStatus::BANNED).size());
+    }
+    ASSERT(get<0>(sharded_server.MatchDocument("cat dog bird"s, 7)) == get<0>(server.MatchDocument("cat dog bird"s, 7)));
+    ASSERT(sharded_server.GetWordFrequencies(7) == server.GetWordFrequencies(7));
+    try {
+        sharded_server.AddDocument(7, "duplicate"s, DocumentStatus::ACTUAL, {});
+        ASSERT_HINT(false, "Adding a document with an existing id must throw"s);
+    }
+    catch (const invalid_argument&) {
+    }
+}
+
+//  ,        ,      
+void TestQueryArena() {
+    SearchServer server("and"s);
+    for (int id = 0; id < 5000; ++id) {
+        server.AddDocument(id, id % 3 == 0 ? "curly cat and fancy collar"s : "big dog"s, DocumentStatus::ACTUAL, { id % 10 });
+    }
+    server.SetMaxResultDocumentCount(5000);
+    const vector<string> queries = { "curly dog"s, "cat -collar"s, "big -cat"s, "fancy"s };
+    vector<vector<Document>> expected_results;
+    for (const string& query : queries) {
+        expected_results.push_back(server.FindTopDocuments(query));
+    }
+    ASSERT_EQUAL(expected_results[0].size(), 5000u);
+    ASSERT_EQUAL(expected_results[1].size(), 0u);
+    ASSERT_EQUAL(expected_results[2].size(), 3333u);
+    //           
+    const auto same_documents = [](vector<Document> lhs, vector<Document> rhs) {
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+        const auto by_id = [](const Document& lhs, const Document& rhs) {
+            return lhs.id < rhs.id;
+        };
+        sort(lhs.begin(), lhs.end(), by_id);
+        sort(rhs.begin(), rhs.end(), by_id);
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            if (lhs[i].id != rhs[i].id || lhs[i].rating != rhs[i].rating || abs(lhs[i].relevance - rhs[i].relevance) >= EPSILON) {
+                return false;
+            }
+        }
+        return true;
+    };
+    for (int round = 0; round < 3; ++round) {
+        for (size_t i = 0; i < queries.size(); ++i) {
+            ASSERT_HINT(same_documents(server.FindTopDocuments(queries[i]), expected_results[i]), "Reused arena must not change results"s);
+            ASSERT_HINT(same_documents(server.FindTopDocuments(execution::par, queries[i]), expected_results[i]), "Reused arena must not change results"s);
+        }
+    }
+    const auto nested_results = server.FindTopDocuments("curly dog"s, [&](int id, DocumentStatus status, int rating) {
+        return id % 1000 != 0 || same_documents(server.FindTopDocuments("big -cat"s), expected_results[2]);
+    });
+    ASSERT_EQUAL(nested_results.size(), 5000u);
+    const auto parallel_results = ProcessQueries(server, vector<string>(64, "curly dog"s));
+    for (const vector<Document>& documents : parallel_results) {
+        ASSERT(same_documents(documents, expected_results[0]));
+    }
+    try {
+        server.FindTopDocuments("curly --dog"s);
+        ASSERT_HINT(false, "Invalid query must throw"s);
+    }
+    catch (const invalid_argument&) {
+    }
+    ASSERT(same_documents(server.FindTopDocuments(queries[0]), expected_results[0]));
+}
+
+//  ,            
+void TestRelevanceAccumulator() {
+    const int ordinal_begin = 500;
+    const int ordinal_end = 10500;
+    const size_t ordinal_count = static_cast<size_t>(ordinal_end - ordinal_begin);
+    const auto check_candidates = [](const RelevanceAccumulator& accumulator, const map<int, double>& expected_relevance) {
+        const vector<pair<int, double>> expected_candidates(expected_relevance.begin(), expected_relevance.end());
+        ASSERT_EQUAL(accumulator.GetCandidateCount(), expected_candidates.size());
+        const auto candidates = accumulator.GetSortedCandidates();
+        const bool is_expected = equal(candidates.begin(), candidates.end(), expected_candidates.begin(), expected_candidates.end());
+        ASSERT_HINT(is_expected, "Candidates must be summed and sorted by ordinal"s);
+    };
+    for (int round = 0; round < 2; ++round) {
+        RelevanceAccumulator dense_accumulator(ordinal_begin, ordinal_end, ordinal_count / 2, pmr::get_default_resource());
+        //  : -  
+        RelevanceAccumulator sparse_accumulator(ordinal_begin, ordinal_end, 10, pmr::get_default_resource());
+        //       
+        RelevanceAccumulator nested_accumulator(ordinal_begin, ordinal_end, ordinal_count, pmr::get_default_resource());
+        ASSERT(dense_accumulator.IsDense());
+        ASSERT(!sparse_accumulator.IsDense());
+        ASSERT(!nested_accumulator.IsDense());
+        map<int, double> expected_relevance;
+        uint32_t state = 7 + round;
+        for (int i = 0; i < 3000 / (round + 1); ++i) {
+            state = state * 1103515245u + 12345u;
+            const int ordinal = ordinal_begin + static_cast<int>((state >> 8) % ordinal_count);
+            const double relevance = i % 5 == 0 ? 0.0 : (state >> 20) / 16.0;
+            for (RelevanceAccumulator* accumulator : { &dense_accumulator, &sparse_accumulator, &nested_accumulator }) {
+                accumulator->Add(ordinal, relevance);
+            }
+            expected_relevance[ordinal] += relevance;
+        }
+        //            
+        for (const RelevanceAccumulator* accumulator : { &dense_accumulator, &sparse_accumulator, &nested_accumulator }) {
+            check_candidates(*accumulator, expected_relevance);
+        }
+    }
+    const int huge_ordinal_end = static_cast<int>(MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT) + 1;
+    RelevanceAccumulator huge_accumulator(0, huge_ordinal_end, MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT, pmr::get_default_resource());
+    ASSERT_HINT(!huge_accumulator.IsDense(), "Dense arrays must be bounded"s);
+    huge_accumulator.Add(huge_ordinal_end - 1, 1.0);
+    check_candidates(huge_accumulator, { { huge_ordinal_end - 1, 1.0 } });
+}
+
+//  ,       ,   AddDocument,      
+void TestAddDocuments() {
+    vector<string> texts;
+    for (int id = 0; id < 5000; ++id) {
+        texts.push_back(MakeTestText(id, 6));
+    }
+    texts[17] = "big -"s;
+    texts[2500] = "curly c\x12t"s;
+    texts[4000] = ""s;
+    SearchServer server("and"s);
+    SearchServer expected_server("and"s);
+    server.AddDocument(3, "fish"s, DocumentStatus::ACTUAL, { 1 });
+    expected_server.AddDocument(3, "fish"s, DocumentStatus::ACTUAL, { 1 });
+    vector<NewDocument> documents;
+    for (int id = 0; id < 5000; ++id) {
+        documents.push_back({ id == 42 ? -1 : id == 99 ? 98 : id, texts[id], id % 3 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id % 5, -id % 3 } });
+    }
+    for (const NewDocument& document : documents) {
+        try {
+            expected_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        }
+        catch (const invalid_argument&) {
+        }
+    }
+    const vector<RejectedDocument> rejected_documents = server.AddDocuments(documents);
+    ASSERT_EQUAL(rejected_documents.size(), 5u);
+    const vector<size_t> expected_positions = { 3, 17, 42, 99, 2500 };
+    for (size_t i = 0; i < rejected_documents.size(); ++i) {
+        ASSERT_EQUAL(rejected_documents[i].position, expected_positions[i]);
+        ASSERT_EQUAL(rejected_documents[i].id, documents[expected_positions[i]].id);
+    }
+    ASSERT_EQUAL(rejected_documents[0].reason, "incorrect id"s);
+    ASSERT_EQUAL(rejected_documents[1].reason, "incorrect using minuses"s);
+    server.AddDocument(6000, "curly fish"s, DocumentStatus::ACTUAL, { 2 });
+    expected_server.AddDocument(6000, "curly fish"s, DocumentStatus::ACTUAL, { 2 });
+    ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+    ASSERT(vector<int>(server.begin(), server.end()) == vector<int>(expected_server.begin(), expected_server.end()));
+    for (const int id : { 0, 1, 98, 2501, 4000, 4999, 6000 }) {
+        ASSERT(server.GetWordFrequencies(id) == expected_server.GetWordFrequencies(id));
+    }
+    server.SetMaxResultDocumentCount(10000);
+    expected_server.SetMaxResultDocumentCount(10000);
+    for (const string& query : { "curly cat"s, "big fish -dog"s, "tail collar -small -fancy"s }) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const auto found_docs = server.FindTopDocuments(query, status);
+            const auto expected_docs = expected_server.FindTopDocuments(query, status);
+            ASSERT_EQUAL(found_docs.size(), expected_docs.size());
+            for (size_t i = 0; i < found_docs.size(); ++i) {
+                ASSERT_EQUAL(found_docs[i].id, expected_docs[i].id);
+                ASSERT_HINT(abs(found_docs[i].relevance - expected_docs[i].relevance) < EPSILON, "Batch must rank as single additions"s);
+            }
+        }
+    }
+    ASSERT(server.AddDocuments(vector<NewDocument>{}).empty());
+    //     id,    - id,   AddDocument
+    const vector<NewDocument> invalid_documents = { { 3, "curly c\x12t"sv, DocumentStatus::ACTUAL, { 1 } },
+        { -7, "big -"sv, DocumentStatus::ACTUAL, { 1 } }, { 7000, "fish -"sv, DocumentStatus::ACTUAL, { 1 } }, { 7000, "curly c\x12t"sv, DocumentStatus::ACTUAL, { 1 } } };
+    const vector<RejectedDocument> invalid_rejected_documents = server.AddDocuments(invalid_documents);
+    ASSERT_EQUAL(invalid_rejected_documents.size(), 4u);
+    const vector<string> expected_reasons = { "incorrect id"s, "incorrect id"s, "incorrect using minuses"s, "query includes special characters"s };
+    for (size_t i = 0; i < invalid_rejected_documents.size(); ++i) {
+        ASSERT_EQUAL(invalid_rejected_documents[i].reason, expected_reasons[i]);
+        try {
+            expected_server.AddDocument(invalid_documents[i].id, invalid_documents[i].text, invalid_documents[i].status, invalid_documents[i].ratings);
+            ASSERT_HINT(false, "AddDocument must reject the document too"s);
+        }
+        catch (const invalid_argument& error) {
+            ASSERT_EQUAL(invalid_rejected_documents[i].reason, string(error.what()));
+        }
+    }
+}
+
+//     :    ,      
+void TestLoadDocuments() {
+    string dump = "1\tACTUAL\t7 2 7\tcurly cat curly tail\r\n"s
+        "\n"s
+        "2\tBANNED\t\tcurly dog and fancy collar\n"s
+        "x\tACTUAL\t1\tbad id\n"s
+        "3\tUNKNOWN\t1\tbad status\n"s
+        "4\tACTUAL\t1 z\tbad rating\n"s
+        "5\tACTUAL\tmissing text\n"s
+        "1\tACTUAL\t1\tduplicate id\n"s
+        "6\tACTUAL\t-1\tbig -\n"s;
+    string long_text;
+    while (long_text.size() <= DOCUMENT_LOADER_BLOCK_SIZE) {
+        long_text += "sparrow "s;
+    }
+    dump += "7\tIRRELEVANT\t5\t"s + long_text + "\n"s;
+    const int document_count = 100000;
+    for (int id = 10; id < document_count; ++id) {
+        dump += to_string(id) + "\tACTUAL\t"s + to_string(id % 10) + " 1\tbig dog "s + to_string(id % 97) + " collar\n"s;
+    }
+    dump += "100000\tACTUAL\t\tlast line without newline"s;
+    istringstream input(dump);
+    SearchServer server("and"s);
+    const vector<RejectedDocument> rejected_documents = LoadDocuments(input, server);
+    ASSERT_EQUAL(rejected_documents.size(), 6u);
+    const vector<size_t> expected_positions = { 3, 4, 5, 6, 7, 8 };
+    for (size_t i = 0; i < rejected_documents.size(); ++i) {
+        ASSERT_EQUAL(rejected_documents[i].position, expected_positions[i]);
+    }
+    ASSERT_EQUAL(rejected_documents[0].reason, "malformed record"s);
+    ASSERT_EQUAL(rejected_documents[4].id, 1);
+    ASSERT_EQUAL(rejected_documents[4].reason, "incorrect id"s);
+    ASSERT_EQUAL(rejected_documents[5].reason, "incorrect using minuses"s);
+    ASSERT_EQUAL(server.GetDocumentCount(), document_count - 10 + 4);
+    const SearchServer::WordFrequencies word_frequencies = server.GetWordFrequencies(1);
+    ASSERT((map<string_view, double>(word_frequencies.begin(), word_frequencies.end())) == (map<string_view, double>{ { "cat"sv, 0.25 }, { "curly"sv, 0.5 }, { "tail"sv, 0.25 } }));
+    ASSERT_EQUAL(server.GetWordFrequencies(7).size(), 1u);
+    ASSERT_EQUAL(server.GetWordFrequencies(100000).size(), 4u);
+    ASSERT_EQUAL(server.GetWordFrequencies(54321).count("1"sv), 1u);
+    const auto found_docs = server.FindTopDocuments("curly"s, DocumentStatus::BANNED);
+    ASSERT_EQUAL(found_docs.size(), 1u);
+    ASSERT_EQUAL(found_docs[0].rating, 0);
+    ASSERT_EQUAL(server.FindTopDocuments("sparrow"s, DocumentStatus::IRRELEVANT).at(0).rating, 5);
+    istringstream empty_input(""s);
+    ASSERT(LoadDocuments(empty_input, server).empty());
+    // ,          
+    class FailingStreamBuffer : public streambuf {
+    public:
+        explicit FailingStreamBuffer(string data)
+            : data_(move(data))
+        {
+            setg(data_.data(), data_.data(), data_.data() + data_.size());
+        }
+
+    protected:
+        int_type underflow() override {
+            throw runtime_error("device failure"s);
+        }
+
+    private:
+        string data_;
+    };
+    FailingStreamBuffer failing_buffer("8\tACTUAL\t1\tfailing stream\n"s);
+    istream failing_input(&failing_buffer);
+    SearchServer failing_server;
+    bool is_failure_reported = false;
+    try {
+        LoadDocuments(failing_input, failing_server);
+    }
+    catch (const ios_base::failure&) {
+        is_failure_reported = true;
+    }
+    ASSERT_HINT(is_failure_reported, "A read error must not be taken for the end of the input"s);
+}
+
+//  ,          
+void TestConcurrentRequestQueue() {
+    SearchServer server("and in"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
+    ConcurrentRequestQueue request_queue(server);
+    for (int i = 0; i < 1439; ++i) {
+        request_queue.AddFindRequest("empty request"s);
+    }
+    request_queue.AddFindRequest("curly dog"s);
+    request_queue.AddFindRequest("big collar"s);
+    request_queue.AddFindRequest("sparrow"s);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1438);
+    ConcurrentRequestQueue::WindowStatistics statistics = request_queue.GetStatistics();
+    ASSERT_EQUAL(statistics.request_count, REQUEST_WINDOW_SIZE);
+    ASSERT_EQUAL(statistics.result_document_count, 3u);
+
+    ASSERT_EQUAL(ConcurrentRequestQueue::GetLatencyBucket(500ns), 0u);
+    ASSERT_EQUAL(ConcurrentRequestQueue::GetLatencyBucket(1us), 1u);
+    ASSERT_EQUAL(ConcurrentRequestQueue::GetLatencyBucket(3us), 2u);
+    ASSERT_EQUAL(ConcurrentRequestQueue::GetLatencyBucket(1000s), LATENCY_BUCKET_COUNT - 1);
+
+    //     ,    
+    const auto record_from_threads = [&request_queue](size_t result_document_count, chrono::nanoseconds latency) {
+        vector<thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&request_queue, result_document_count, latency]() {
+                for (int i = 0; i < 2000; ++i) {
+                    request_queue.RecordRequest(result_document_count, latency);
+                    request_queue.GetStatistics();
+                }
+            });
+        }
+        for (thread& recording_thread : threads) {
+            recording_thread.join();
+        }
+    };
+    record_from_threads(0, 5us);
+    statistics = request_queue.GetStatistics();
+    ASSERT_EQUAL(statistics.request_count, REQUEST_WINDOW_SIZE);
+    ASSERT_EQUAL(statistics.no_result_request_count, REQUEST_WINDOW_SIZE);
+    ASSERT_EQUAL(statistics.latency_bucket_counts[3], REQUEST_WINDOW_SIZE);
+    record_from_threads(2, 100ms);
+    statistics = request_queue.GetStatistics();
+    ASSERT_EQUAL(statistics.request_count, REQUEST_WINDOW_SIZE);
+    ASSERT_EQUAL(statistics.no_result_request_count, 0u);
+    ASSERT_EQUAL(statistics.result_document_count, 2 * REQUEST_WINDOW_SIZE);
+    ASSERT_EQUAL(statistics.latency_bucket_counts[17], REQUEST_WINDOW_SIZE);
+}
+
+//           ,    
+void TestQueryProfile() {
+    QueryHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.Add(value);
+    }
+    ASSERT_EQUAL(histogram.GetCount(), 1000u);
+    ASSERT_EQUAL(histogram.GetSum(), 500500u);
+    ASSERT_EQUAL(histogram.GetMax(), 1000u);
+    for (const double percentile : { 50.0, 90.0, 99.0 }) {
+        const double value = static_cast<double>(histogram.GetPercentile(percentile));
+        ASSERT_HINT(value >= percentile * 10.0 && value < percentile * 10.0 * (1.0 + 1.0 / 16.0), "Percentile must be within a bucket of the value"s);
+    }
+    ASSERT_EQUAL(histogram.GetPercentile(100.0), 1000u);
+    for (const uint64_t value : { 0ull, 15ull, 16ull, 17ull, 1000000ull, ~0ull }) {
+        const size_t bucket = QueryHistogram::GetBucket(value);
+        ASSERT(bucket < QUERY_HISTOGRAM_BUCKET_COUNT);
+        ASSERT(value <= QueryHistogram::GetBucketUpperBound(bucket));
+        ASSERT(bucket == 0 || value > QueryHistogram::GetBucketUpperBound(bucket - 1));
+    }
+
+    const QueryProfileSnapshot profile_before = GetQueryProfileSnapshot();
+    const auto record_query = []() {
+        QueryProfileScope query;
+        {
+            QueryStageTimer timer(QueryStage::POSTINGS);
+            CountQueryEvent(QueryCounter::POSTINGS_SCANNED, 40);
+            QueryProfileScope nested_query;
+            CountQueryEvent(QueryCounter::POSTINGS_SCANNED, 2);
+        }
+        CountQueryEvent(QueryCounter::CANDIDATES, 7);
+    };
+    record_query();
+    thread(record_query).join();
+    CountQueryEvent(QueryCounter::CANDIDATES, 1000);
+    const QueryProfileSnapshot profile = GetQueryProfileSnapshot();
+    const QueryHistogram& total = profile.stage_nanoseconds[static_cast<size_t>(QueryStage::TOTAL)];
+    ASSERT_EQUAL_HINT(total.GetCount() - profile_before.stage_nanoseconds[static_cast<size_t>(QueryStage::TOTAL)].GetCount(), 2u, "Nested queries must be a part of the outer one"s);
+    const QueryHistogram& postings_scanned = profile.counters[static_cast<size_t>(QueryCounter::POSTINGS_SCANNED)];
+    ASSERT_EQUAL(postings_scanned.GetSum() - profile_before.counters[static_cast<size_t>(QueryCounter::POSTINGS_SCANNED)].GetSum(), 84u);
+    const QueryHistogram& candidates = profile.counters[static_cast<size_t>(QueryCounter::CANDIDATES)];
+    ASSERT_EQUAL_HINT(candidates.GetSum() - profile_before.counters[static_cast<size_t>(QueryCounter::CANDIDATES)].GetSum(), 14u, "Counts outside a query must be dropped"s);
+    ostringstream dump;
+    DumpQueryProfile(dump);
+    ASSERT(dump.str().find("postings_scanned: count "s) != string::npos);
+}
+
+//  ,  Open     , ,     ,           
+void TestOpenCorruptedIndex() {
+    const string path = (filesystem::temp_directory_path() / "search_server_corrupted.index"s).string();
+    SearchServer server;
+    server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, { 1 });
+    server.Save(path);
+    string index;
+    {
+        ifstream input(path, ios::binary);
+        index.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    }
+    //          -  - 
+    //  16- ,    80-,    108-,  
+    //    120-,     128-,   
+    //     212-,       232-
+    const size_t stop_word_count_offset = 16;
+    const size_t document_frequency_offset = 80;
+    const size_t document_status_offset = 108;
+    const size_t document_terms_end_offset = 120;
+    const size_t document_term_id_offset = 128;
+    const size_t block_last_ordinal_offset = 212;
+    const size_t block_data_offset = 232;
+    const auto read_int = [&index](size_t offset) {
+        int value = 0;
+        memcpy(&value, index.data() + offset, sizeof(value));
+        return value;
+    };
+    ASSERT_EQUAL(read_int(stop_word_count_offset), 0);
+    ASSERT_EQUAL(read_int(document_frequency_offset), 1);
+    ASSERT_EQUAL(read_int(document_status_offset), static_cast<int>(DocumentStatus::ACTUAL));
+    ASSERT_EQUAL(read_int(document_terms_end_offset), 1);
+    ASSERT_EQUAL(read_int(document_term_id_offset), 0);
+    ASSERT_EQUAL(read_int(block_last_ordinal_offset), 0);
+    ASSERT_EQUAL(static_cast<int>(index[block_data_offset]), 1);
+    const auto open_corrupted = [&index, &path](size_t offset, auto value) {
+        string corrupted_index = index;
+        memcpy(corrupted_index.data() + offset, &value, sizeof(value));
+        {
+            ofstream output(path, ios::binary | ios::trunc);
+            output << corrupted_index;
+        }
+        return SearchServer::Open(path);
+    };
+    const auto is_rejected = [&open_corrupted](size_t offset, auto value) {
+        try {
+            open_corrupted(offset, value);
+        }
+        catch (const runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    ASSERT(!is_rejected(document_status_offset, static_cast<int>(DocumentStatus::BANNED)));
+    ASSERT_HINT(is_rejected(stop_word_count_offset, numeric_limits<uint64_t>::max()), "Stop word count must be bounded"s);
+    ASSERT_HINT(is_rejected(stop_word_count_offset, uint64_t{ 1 } << 40), "Stop word count must be bounded"s);
+    ASSERT_HINT(is_rejected(document_frequency_offset, -1), "Negative document frequency must be rejected"s);
+    ASSERT_HINT(is_rejected(document_frequency_offset, 2), "Document frequency above the document count must be rejected"s);
+    ASSERT_HINT(is_rejected(document_status_offset, -1), "Unknown document status must be rejected"s);
+    ASSERT_HINT(is_rejected(document_status_offset, static_cast<int>(DocumentStatus::REMOVED) + 1), "Unknown document status must be rejected"s);
+    ASSERT_HINT(is_rejected(document_terms_end_offset, uint64_t{ 2 }), "Forward index past its section must be rejected"s);
+    ASSERT_HINT(is_rejected(block_last_ordinal_offset, 1), "Block ordinals beyond the segment must be rejected"s);
+
+    //          
+    SearchServer server_with_bad_term = open_corrupted(document_term_id_offset, 1000);
+    ASSERT(server_with_bad_term.GetWordFrequencies(1).empty());
+    server_with_bad_term.RemoveDocument(1);
+    ASSERT_EQUAL(server_with_bad_term.GetDocumentCount(), 0);
+    const SearchServer server_with_bad_block = open_corrupted(block_data_offset, uint8_t{ 0 });
+    ASSERT_HINT(server_with_bad_block.FindTopDocuments("cat"s).empty(), "A posting with a zero term count must not be decoded"s);
+    ASSERT_EQUAL(get<0>(server_with_bad_block.MatchDocument("cat"s, 1)).size(), 1u);
+    filesystem::remove(path);
+}
+
+//  ,      ,       
+void TestOrdinalCompaction() {
+    const int document_count = 3 * static_cast<int>(ORDINAL_COMPACTION_MIN_REMOVED_COUNT) + 100;
+    SearchServer server;
+    SearchServer expected_server;
+    for (int id = 0; id < document_count; ++id) {
+        server.AddDocument(id, MakeTestText(id, 3), DocumentStatus::ACTUAL, { id % 7 });
+        if (id % 10 == 0) {
+            expected_server.AddDocument(id, MakeTestText(id, 3), DocumentStatus::ACTUAL, { id % 7 });
+        }
+    }
+    for (int id = 0; id < document_count; ++id) {
+        if (id % 10 != 0) {
+            server.RemoveDocument(id);
+            const size_t removed_ordinal_count = server.GetOrdinalCount() - static_cast<size_t>(server.GetDocumentCount());
+            ASSERT_HINT(removed_ordinal_count <= max(static_cast<size_t>(server.GetDocumentCount()), ORDINAL_COMPACTION_MIN_REMOVED_COUNT),
+                "Removed ordinals must be compacted"s);
+        }
+    }
+    ASSERT(server.GetOrdinalCount() < static_cast<size_t>(document_count));
+    //      ,   
+    const auto check_same_results = [&expected_server](const SearchServer& search_server) {
+        for (const string& query : { "cat dog"s, "curly -fish"s, "big small -cat -dog"s }) {
+            const auto found_docs = search_server.FindTopDocuments(query);
+            const auto expected_docs = expected_server.FindTopDocuments(query);
+            ASSERT_EQUAL(found_docs.size(), expected_docs.size());
+            for (size_t i = 0; i < found_docs.size(); ++i) {
+                ASSERT_EQUAL(found_docs[i].id, expected_docs[i].id);
+                ASSERT(abs(found_docs[i].relevance - expected_docs[i].relevance) < EPSILON);
+            }
+        }
+        ASSERT(get<0>(search_server.MatchDocument("cat dog bird"s, 10)) == get<0>(expected_server.MatchDocument("cat dog bird"s, 10)));
+    };
+    server.SetMaxResultDocumentCount(static_cast<size_t>(document_count));
+    expected_server.SetMaxResultDocumentCount(static_cast<size_t>(document_count));
+    check_same_results(server);
+
+    server.AddDocument(document_count, "curly parrot"s, DocumentStatus::ACTUAL, { 1 });
+    expected_server.AddDocument(document_count, "curly parrot"s, DocumentStatus::ACTUAL, { 1 });
+    server.RemoveDocument(20);
+    expected_server.RemoveDocument(20);
+    server.MergeSegments();
+    ASSERT_EQUAL_HINT(server.GetOrdinalCount(), static_cast<size_t>(server.GetDocumentCount()), "Merging all segments must compact every ordinal"s);
+    check_same_results(server);
+    server.RemoveDocument(30);
+    server.RemoveDocument(40);
+    ASSERT(server.GetOrdinalCount() > static_cast<size_t>(server.GetDocumentCount()));
+}
+
+// ,          
+void TestVersionedSearchServerSharesChunks() {
+    const int document_count = 20000;
+    SearchServer search_server;
+    for (int id = 0; id < document_count; ++id) {
+        search_server.AddDocument(id, "word"s + to_string(id % 3000) + " common"s, DocumentStatus::ACTUAL, { id % 10 });
+    }
+    search_server.MergeSegments();
+    VersionedSearchServer versioned_server(move(search_server));
+    const shared_ptr<const SearchServer> snapshot = versioned_server.GetSnapshot();
+    versioned_server.Update([document_count](SearchServer& server) {
+        server.AddDocument(document_count, "word7 fresh"s, DocumentStatus::ACTUAL, { 5 });
+        server.RemoveDocument(5);
+    });
+    const shared_ptr<const SearchServer> next_snapshot = versioned_server.GetSnapshot();
+    ASSERT(snapshot->GetChunkCount() > 100u);
+    ASSERT_HINT(snapshot->GetChunkCount() - next_snapshot->CountSharedChunks(*snapshot) <= 8u,
+        "A new version must copy only the chunks it changes"s);
+    ASSERT_EQUAL(snapshot->GetDocumentCount(), document_count);
+    ASSERT_EQUAL(next_snapshot->GetDocumentCount(), document_count);
+    ASSERT(snapshot->FindTopDocuments("fresh"s).empty());
+    ASSERT_EQUAL(next_snapshot->FindTopDocuments("fresh"s).size(), 1u);
+    ASSERT_EQUAL(snapshot->GetWordFrequencies(5).size(), 2u);
+    ASSERT(next_snapshot->GetWordFrequencies(5).empty());
+    ASSERT_EQUAL(snapshot->GetDocumentFrequency("word5"s), 7);
+    ASSERT_EQUAL(next_snapshot->GetDocumentFrequency("word5"s), 6);
+    ASSERT_EQUAL(next_snapshot->GetDocumentFrequency("word7"s), 8);
+}
+
+// ,       MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT     
+void TestDenseRelevanceOnLargeCorpus() {
+    const int document_count = static_cast<int>(MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT) + 100000;
+    const int batch_size = 65536;
+    SearchServer server;
+    vector<NewDocument> documents;
+    for (int batch_begin = 0; batch_begin < document_count; batch_begin += batch_size) {
+        documents.clear();
+        for (int id = batch_begin; id < min(document_count, batch_begin + batch_size); ++id) {
+            documents.push_back({ id, id % 2 == 0 ? "cat"sv : "cat dog"sv, DocumentStatus::ACTUAL, { id % 7 } });
+        }
+        ASSERT(server.AddDocuments(documents).empty());
+    }
+
+    const uint64_t dense_count_before = RelevanceAccumulator::GetDenseAccumulatorCount();
+    const vector<Document> found_docs = server.FindTopDocuments("dog"s);
+    ASSERT_EQUAL_HINT(RelevanceAccumulator::GetDenseAccumulatorCount() - dense_count_before, 2u,
+        "Every range of ordinals must be scored in the dense array"s);
+    ASSERT_EQUAL(found_docs.size(), 5u);
+    ASSERT_EQUAL(found_docs[0].id, 13);
+    ASSERT_EQUAL(found_docs[0].rating, 6);
+
+    const int last_range_begin = static_cast<int>(MAX_DENSE_ACCUMULATOR_ORDINAL_COUNT);
+    const auto in_last_range = [last_range_begin](int id, DocumentStatus status, int rating) {
+        return id >= last_range_begin;
+    };
+    const vector<Document> last_range_docs = server.FindTopDocuments("dog"s, in_last_range);
+    ASSERT_EQUAL(last_range_docs.size(), 5u);
+    ASSERT(last_range_docs[0].id >= last_range_begin && last_range_docs[0].id % 2 == 1 && last_range_docs[0].rating == 6);
+    const vector<Document> parallel_docs = server.FindTopDocuments(execution::par, "dog"s, in_last_range);
+    ASSERT_EQUAL(parallel_docs.size(), last_range_docs.size());
+    for (size_t i = 0; i < parallel_docs.size(); ++i) {
+        ASSERT_EQUAL(parallel_docs[i].id, last_range_docs[i].id);
+    }
+}
+
 //  
 void TestSearchServer() {
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
@@ -201,4 +1283,31 @@ void TestSearchServer() {
     RUN_TEST(TestSearchWithPredicateFilter);
     RUN_TEST(TestSearchWithStatusFilter);
     RUN_TEST(TestCalculateRelevance);
+    RUN_TEST(TestMatchDocument);
+    RUN_TEST(TestAddDocumentsInAnyIdOrder);
+    RUN_TEST(TestParallelFindTopDocuments);
+    RUN_TEST(TestProcessQueries);
+    RUN_TEST(TestMaxResultDocumentCount);
+    RUN_TEST(TestRemoveDocument);
+    RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestRejectControlCharacters);
+    RUN_TEST(TestIdfFollowsDocumentCount);
+    RUN_TEST(TestVersionedSearchServer);
+    RUN_TEST(TestSegmentedIndex);
+    RUN_TEST(TestSaveAndOpen);
+    RUN_TEST(TestCompressedPostings);
+    RUN_TEST(TestMinusWordsAcrossBlocks);
+    RUN_TEST(TestParallelMatchDocument);
+    RUN_TEST(TestQueryResultCache);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestQueryArena);
+    RUN_TEST(TestRelevanceAccumulator);
+    RUN_TEST(TestAddDocuments);
+    RUN_TEST(TestLoadDocuments);
+    RUN_TEST(TestConcurrentRequestQueue);
+    RUN_TEST(TestQueryProfile);
+    RUN_TEST(TestOpenCorruptedIndex);
+    RUN_TEST(TestOrdinalCompaction);
+    RUN_TEST(TestVersionedSearchServerSharesChunks);
+    RUN_TEST(TestDenseRelevanceOnLargeCorpus);
 }
\ No newline at end of file
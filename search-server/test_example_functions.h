@@ -32,4 +32,31 @@ void TestCalculateAverageRating();
 void TestSearchWithPredicateFilter();
 void TestSearchWithStatusFilter();
 void TestCalculateRelevance();
+void TestMatchDocument();
+void TestAddDocumentsInAnyIdOrder();
+void TestParallelFindTopDocuments();
+void TestProcessQueries();
+void TestMaxResultDocumentCount();
+void TestRemoveDocument();
+void TestRemoveDuplicates();
+void TestRejectControlCharacters();
+void TestIdfFollowsDocumentCount();
+void TestVersionedSearchServer();
+void TestSegmentedIndex();
+void TestSaveAndOpen();
+void TestCompressedPostings();
+void TestMinusWordsAcrossBlocks();
+void TestParallelMatchDocument();
+void TestQueryResultCache();
+void TestShardedSearchServer();
+void TestQueryArena();
+void TestRelevanceAccumulator();
+void TestAddDocuments();
+void TestLoadDocuments();
+void TestConcurrentRequestQueue();
+void TestQueryProfile();
+void TestOpenCorruptedIndex();
+void TestOrdinalCompaction();
+void TestVersionedSearchServerSharesChunks();
+void TestDenseRelevanceOnLargeCorpus();
 void TestSearchServer();
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "versioned_search_server.h"
+
+using namespace std;
+
+VersionedSearchServer::VersionedSearchServer(SearchServer search_server)
+    : search_server_(make_shared<const SearchServer>(move(search_server)))
+{
+}
+
+shared_ptr<const SearchServer> VersionedSearchServer::GetSnapshot() const {
+    return atomic_load(&search_server_);
+}
+
+void VersionedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    Update([document_id, document, status, &ratings](SearchServer& search_server) {
+        search_server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void VersionedSearchServer::RemoveDocument(int document_id) {
+    Update([document_id](SearchServer& search_server) {
+        search_server.RemoveDocument(document_id);
+    });
+}
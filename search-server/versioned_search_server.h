@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Lets queries run while documents are added or removed. Readers take the current
+// version with GetSnapshot and query it without locks; it stays alive and unchanged
+// for as long as they hold it. A writer copies the current version, changes the
+// copy and publishes it with an atomic pointer swap. The copy shares the chunks of
+// the index tables and the sealed segments with the current version, so it costs
+// the active segment and one pointer per chunk, and a change copies only the chunks
+// it touches. An old version is freed when its last reader releases it.
+class VersionedSearchServer {
+public:
+    explicit VersionedSearchServer(SearchServer search_server);
+
+    std::shared_ptr<const SearchServer> GetSnapshot() const;
+
+    // Applies several changes to one copy, so a batch pays for the copy once.
+    template <typename Updater>
+    void Update(Updater updater);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+private:
+    std::shared_ptr<const SearchServer> search_server_;
+    std::mutex update_mutex_;
+};
+
+template <typename Updater>
+void VersionedSearchServer::Update(Updater updater) {
+    std::lock_guard guard(update_mutex_);
+    auto next_version = std::make_shared<SearchServer>(*search_server_);
+    updater(*next_version);
+    std::atomic_store(&search_server_, std::shared_ptr<const SearchServer>(std::move(next_version)));
+}